@@ -0,0 +1,77 @@
+#include <u.h>
+#include <libc.h>
+#include <draw.h>
+#include "../include/9deui/9deui.h"
+
+/*
+ * resample.bench — ui9icon_resample on 256 px sources.
+ *
+ * Prints one CSV row per target size:
+ *   src,dst,kernel,iters,ns_per_op,mpix_per_s
+ * kernel is "box" for whole ratios and "box+bilinear"/"bilinear" otherwise.
+ *
+ * Usage: resample.bench [-n iters]
+ */
+
+enum { Src = 256 };
+
+static uchar src[Src*Src*4];
+static uchar dst[512*512*4];
+
+static int sizes[] = { 16, 20, 24, 32, 48, 64, 96, 128, 192, 512 };
+
+static char*
+kernel(int d)
+{
+	if(d <= Src && Src % d == 0)
+		return "box";
+	if(d < Src/2)
+		return "box+bilinear";
+	return "bilinear";
+}
+
+static void
+usage(void)
+{
+	fprint(2, "usage: resample.bench [-n iters]\n");
+	exits("usage");
+}
+
+void
+main(int argc, char **argv)
+{
+	int i, k, d, iters;
+	vlong t0, dt;
+
+	iters = 200;
+	ARGBEGIN{
+	case 'n':
+		iters = atoi(EARGF(usage()));
+		break;
+	default:
+		usage();
+	}ARGEND
+	if(iters <= 0)
+		usage();
+
+	/* something with structure: diagonal ramps + a hard edge */
+	for(i=0; i<Src*Src; i++){
+		src[i*4+0] = 255;
+		src[i*4+1] = (i % Src);
+		src[i*4+2] = (i / Src);
+		src[i*4+3] = ((i % Src) < Src/2) ? 0 : 255;
+	}
+
+	print("src,dst,kernel,iters,ns_per_op,mpix_per_s\n");
+	for(k=0; k<nelem(sizes); k++){
+		d = sizes[k];
+		ui9icon_resample(src, Src, Src, dst, d, d);   /* warm */
+		t0 = nsec();
+		for(i=0; i<iters; i++)
+			ui9icon_resample(src, Src, Src, dst, d, d);
+		dt = (nsec() - t0) / iters;
+		print("%d,%d,%s,%d,%lld,%.1f\n", Src, d, kernel(d), iters, dt,
+			dt > 0 ? (double)Src*Src*1000.0/dt : 0.0);
+	}
+	exits(nil);
+}
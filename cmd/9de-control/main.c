@@ -365,105 +365,65 @@ cfg_apply(char *path)
 	return 0;
 }
 
-static void
-loadcfg_defaults(void)
+/* form fields; defaults match panel/session */
+static Ui9CfgKey controlkeys[] = {
+	{ "start_shell",  Ui9CfgBool, "1" },
+	{ "start_demo",   Ui9CfgBool, "0" },
+	{ "session_mode", Ui9CfgStr,  "normal" },
+	{ "test_layout",  Ui9CfgStr,  "laptop" },
+	{ "panel_left",   Ui9CfgStr,  "menu ws" },
+	{ "panel_right",  Ui9CfgStr,  "preset de net clock notif" },
+	{ "ui_style",     Ui9CfgStr,  "terminal" },
+	{ "ui_alpha",     Ui9CfgInt,  "220", 0, 255 },
+	{ "ui_radius",    Ui9CfgInt,  "10", 0, 24 },
+	{ "ui_topgrad",   Ui9CfgBool, "1" },
+	{ "ui_minigrad",  Ui9CfgBool, "1" },
+	{ "ui_topgrad0",  Ui9CfgStr,  "#0c0c0e" },
+	{ "ui_topgrad1",  Ui9CfgStr,  "#1a1a20" },
+	{ "ui_minigrad0", Ui9CfgStr,  "#101014" },
+	{ "ui_minigrad1", Ui9CfgStr,  "#18181f" },
+};
+
+static int
+pick(char *v, char **names, int n)
 {
-	/* sane defaults (match panel/session defaults) */
-	start_shell = 1;
-	start_demo  = 0;
-	session_sel = 0;
-	layout_sel  = 0;
-	style_sel   = 0;
-	alpha_v     = 220;
-	radius_v    = 10;
-	topgrad_on  = 1;
-	minigrad_on = 1;
-
-	runeset(r_panel_left, MaxField, &n_panel_left, "menu ws");
-	runeset(r_panel_right, MaxField, &n_panel_right, "preset de net clock notif");
-
-	runeset(r_top0, MaxColor, &n_top0, "#0c0c0e");
-	runeset(r_top1, MaxColor, &n_top1, "#1a1a20");
-	runeset(r_mini0, MaxColor, &n_mini0, "#101014");
-	runeset(r_mini1, MaxColor, &n_mini1, "#18181f");
+	int i;
+
+	for(i=0; i<n; i++)
+		if(strcmp(v, names[i]) == 0)
+			return i;
+	return 0;
 }
 
+/* what the files say (defaults.rc < config.rc); env is not ours to edit */
 static void
-loadcfg_fromfile(void)
+loadcfg(void)
 {
-	char path[256];
-	char *in, *p;
-
-	snprint(path, sizeof path, "%s/lib/9de/config.rc", userhome());
-	in = nil;
-	if(readfile(path, &in) < 0)
-		return;
-
-	p = in;
-	while(*p){
-		char *eol = strchr(p, '\n');
-		int len;
-		if(eol == nil) eol = p + strlen(p);
-		len = eol - p;
-
-		char line[MaxLine];
-		if(len >= MaxLine) len = MaxLine-1;
-		memmove(line, p, len);
-		line[len] = 0;
-
-		p = (*eol) ? eol + 1 : eol;
-
-		/* strip comments */
-		{
-			char *c = strchr(line, '#');
-			if(c) *c = 0;
-		}
-		trim(line);
-		if(line[0] == 0)
-			continue;
-
-		char *eq = strchr(line, '=');
-		if(eq == nil) continue;
-
-		*eq = 0;
-		char *key = line;
-		char *val = eq+1;
-		trim(key);
-		trim(val);
-		normalize_list(val);
-
-		if(strcmp(key, "start_shell")==0) start_shell = atoi(val)!=0;
-		else if(strcmp(key, "start_demo")==0) start_demo = atoi(val)!=0;
-		else if(strcmp(key, "session_mode")==0){
-			if(strcmp(val,"test")==0) session_sel=1;
-			else if(strcmp(val,"dev")==0) session_sel=2;
-			else session_sel=0;
-		}else if(strcmp(key, "test_layout")==0){
-			if(strcmp(val,"ultrawide")==0) layout_sel=1;
-			else layout_sel=0;
-		}else if(strcmp(key, "panel_left")==0){
-			runeset(r_panel_left, MaxField, &n_panel_left, val);
-		}else if(strcmp(key, "panel_right")==0){
-			runeset(r_panel_right, MaxField, &n_panel_right, val);
-		}else if(strcmp(key, "ui_style")==0){
-			if(strcmp(val,"dark")==0) style_sel=1;
-			else if(strcmp(val,"glass")==0) style_sel=2;
-			else style_sel=0;
-		}else if(strcmp(key, "ui_alpha")==0){
-			alpha_v = atoi(val);
-			if(alpha_v<0) alpha_v=0; if(alpha_v>255) alpha_v=255;
-		}else if(strcmp(key, "ui_radius")==0){
-			radius_v = atoi(val);
-			if(radius_v<0) radius_v=0; if(radius_v>24) radius_v=24;
-		}else if(strcmp(key, "ui_topgrad")==0) topgrad_on = atoi(val)!=0;
-		else if(strcmp(key, "ui_minigrad")==0) minigrad_on = atoi(val)!=0;
-		else if(strcmp(key, "ui_topgrad0")==0) runeset(r_top0, MaxColor, &n_top0, val);
-		else if(strcmp(key, "ui_topgrad1")==0) runeset(r_top1, MaxColor, &n_top1, val);
-		else if(strcmp(key, "ui_minigrad0")==0) runeset(r_mini0, MaxColor, &n_mini0, val);
-		else if(strcmp(key, "ui_minigrad1")==0) runeset(r_mini1, MaxColor, &n_mini1, val);
-	}
-
-	free(in);
+	static char *modes[] = { "normal", "test", "dev" };
+	static char *layouts[] = { "laptop", "ultrawide" };
+	static char *styles[] = { "terminal", "dark", "glass" };
+	Ui9Cfg *c;
+
+	c = ui9cfg_load(controlkeys, nelem(controlkeys), 0);
+
+	start_shell = ui9cfg_bool(c, "start_shell");
+	start_demo  = ui9cfg_bool(c, "start_demo");
+	session_sel = pick(ui9cfg_str(c, "session_mode"), modes, nelem(modes));
+	layout_sel  = pick(ui9cfg_str(c, "test_layout"), layouts, nelem(layouts));
+	style_sel   = pick(ui9cfg_str(c, "ui_style"), styles, nelem(styles));
+	alpha_v     = ui9cfg_int(c, "ui_alpha");
+	radius_v    = ui9cfg_int(c, "ui_radius");
+	topgrad_on  = ui9cfg_bool(c, "ui_topgrad");
+	minigrad_on = ui9cfg_bool(c, "ui_minigrad");
+
+	runeset(r_panel_left, MaxField, &n_panel_left, ui9cfg_str(c, "panel_left"));
+	runeset(r_panel_right, MaxField, &n_panel_right, ui9cfg_str(c, "panel_right"));
+	runeset(r_top0, MaxColor, &n_top0, ui9cfg_str(c, "ui_topgrad0"));
+	runeset(r_top1, MaxColor, &n_top1, ui9cfg_str(c, "ui_topgrad1"));
+	runeset(r_mini0, MaxColor, &n_mini0, ui9cfg_str(c, "ui_minigrad0"));
+	runeset(r_mini1, MaxColor, &n_mini1, ui9cfg_str(c, "ui_minigrad1"));
+
+	ui9cfg_free(c);
 }
 
 /* -------------- UI -------------- */
@@ -844,8 +804,7 @@ main(int argc, char **argv)
 	default:
 	}ARGEND
 
-	loadcfg_defaults();
-	loadcfg_fromfile();
+	loadcfg();
 
 	if(initdraw(0, 0, "9de-control") < 0)
 		sysfatal("initdraw: %r");
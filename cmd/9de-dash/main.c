@@ -14,6 +14,8 @@
 
 static Ui9 ui;
 
+enum { IconSz = 32 };
+
 static char*
 userhome(void)
 {
@@ -71,9 +73,14 @@ onnote(void*, char *msg)
 	return 1;
 }
 
+/* icon: app name under lib/9de/icons, nil for none; missing ones are cached as misses */
 static void
-tile(Rectangle r, char *title, char *sub, Image *accent)
+tile(Rectangle r, char *title, char *sub, Image *accent, char *icon)
 {
+	Image *img;
+	Rectangle ir;
+	int tx;
+
 	draw(screen, r, ui9img(&ui, Ui9CSurface2), nil, ZP);
 	border(screen, r, 1, ui9img(&ui, Ui9CBorder), ZP);
 
@@ -83,8 +90,23 @@ tile(Rectangle r, char *title, char *sub, Image *accent)
 		draw(screen, a, accent, nil, ZP);
 	}
 
-	ui9_shadowstring(&ui, Pt(r.min.x + 10, r.min.y + 10), title);
-	ui9_mutedstring(&ui, Pt(r.min.x + 10, r.min.y + 28), sub);
+	tx = r.min.x + 10;
+	img = nil;
+	if(icon != nil)
+		img = ui9icon_findr(&ui, icon, IconSz, &ir);
+	if(img != nil && (Dx(ir) != IconSz || Dy(ir) != IconSz)){
+		/* packed or shipped at another size: take the scaled copy */
+		ui9icon_put(&ui, img);
+		if((img = ui9icon_scaled(&ui, icon, IconSz)) != nil)
+			ir = img->r;
+	}
+	if(img != nil){
+		draw(screen, Rect(tx, r.min.y + (Dy(r)-IconSz)/2, tx+IconSz, r.min.y + (Dy(r)+IconSz)/2), img, nil, ir.min);
+		ui9icon_put(&ui, img);
+		tx += IconSz + 10;
+	}
+	ui9_shadowstring(&ui, Pt(tx, r.min.y + 10), title);
+	ui9_mutedstring(&ui, Pt(tx, r.min.y + 28), sub);
 }
 
 static void
@@ -139,13 +161,13 @@ redraw(void)
 	ui9_monosmall(&ui, Pt(c1.min.x, c1.min.y - 2), "LAUNCH");
 	y = c1.min.y + 12;
 	th = 60;
-	tile(Rect(c1.min.x, y, c1.max.x, y+th), "Control Center", "session · placement · styles", ui9img(&ui, Ui9CAccent));
+	tile(Rect(c1.min.x, y, c1.max.x, y+th), "Control Center", "session · placement · styles", ui9img(&ui, Ui9CAccent), "9de-control");
 	y += th + 10;
-	tile(Rect(c1.min.x, y, c1.max.x, y+th), "Launcher", "search apps · recent", nil);
+	tile(Rect(c1.min.x, y, c1.max.x, y+th), "Launcher", "search apps · recent", nil, "launcher");
 	y += th + 10;
-	tile(Rect(c1.min.x, y, c1.max.x, y+th), "Terminal", "rc + plumber", nil);
+	tile(Rect(c1.min.x, y, c1.max.x, y+th), "Terminal", "rc + plumber", nil, "rc");
 	y += th + 10;
-	tile(Rect(c1.min.x, y, c1.max.x, y+th), "Files", "browse /home /usr", nil);
+	tile(Rect(c1.min.x, y, c1.max.x, y+th), "Files", "browse /home /usr", nil, "9de-desktop");
 
 	ui9_monosmall(&ui, Pt(c2.min.x, c2.min.y - 2), "SYSTEM");
 	big = Rect(c2.min.x, c2.min.y + 12, c2.max.x, c2.min.y + 12 + 150);
@@ -156,11 +178,11 @@ redraw(void)
 	ui9_monosmall(&ui, Pt(big.min.x + 12, big.min.y + 66), "cpu 37%   mem 58%   net 21%");
 
 	ty = big.max.y + 12;
-	tile(Rect(c2.min.x, ty, c2.min.x + (Dx(c2)/2) - 7, ty+70), "Panel placement", "top/bottom/left", nil);
-	tile(Rect(c2.min.x + (Dx(c2)/2) + 7, ty, c2.max.x, ty+70), "Style preset", "terminal/dark/glass", nil);
+	tile(Rect(c2.min.x, ty, c2.min.x + (Dx(c2)/2) - 7, ty+70), "Panel placement", "top/bottom/left", nil, nil);
+	tile(Rect(c2.min.x + (Dx(c2)/2) + 7, ty, c2.max.x, ty+70), "Style preset", "terminal/dark/glass", nil, nil);
 
 	ty += 80;
-	tile(Rect(c2.min.x, ty, c2.max.x, ty+70), "Logs", "open .err / .log streams", ui9img(&ui, Ui9CGood));
+	tile(Rect(c2.min.x, ty, c2.max.x, ty+70), "Logs", "open .err / .log streams", ui9img(&ui, Ui9CGood), nil);
 
 	ui9_monosmall(&ui, Pt(c3.min.x, c3.min.y - 2), "SHELL CONTRACT");
 	sc = Rect(c3.min.x, c3.min.y + 12, c3.max.x, c3.min.y + 12 + 220);
@@ -0,0 +1,67 @@
+#include <u.h>
+#include <libc.h>
+#include <draw.h>
+
+#include "../../include/9deui/9deui.h"
+
+/*
+ * 9de-iconindex — index every icon under the icon roots.
+ *
+ * Walks $home/lib/9de/icons and /lib/9de/icons once and writes the
+ * sorted binary index lib9deui searches instead of probing paths (see
+ * include/9deui/icon.h). lib9deui rebuilds it by itself when a root's
+ * qid.vers changes; run this after adding a size to an existing app,
+ * or from the session start so the first lookup finds it ready.
+ *
+ * Usage:
+ *   9de-iconindex [-o out]
+ *
+ * out defaults to $home/lib/9de/icons/index.
+ */
+
+static char*
+home(void)
+{
+	char *h = getenv("home");
+	return h ? h : "/usr/glenda";
+}
+
+static void
+usage(void)
+{
+	fprint(2, "usage: 9de-iconindex [-o out]\n");
+	exits("usage");
+}
+
+void
+main(int argc, char **argv)
+{
+	char *out, outbuf[512];
+	Ui9IconIndex *x;
+
+	out = nil;
+	ARGBEGIN{
+	case 'o':
+		out = EARGF(usage());
+		break;
+	default:
+		usage();
+	}ARGEND
+
+	if(argc != 0)
+		usage();
+	if(out == nil){
+		snprint(outbuf, sizeof outbuf, "%s/lib/9de/icons/index", home());
+		out = outbuf;
+	}
+
+	x = ui9icon_indexscan();
+	if(x == nil)
+		sysfatal("scan: %r");
+	if(ui9icon_indexwrite(x, out) < 0)
+		sysfatal("write %s: %r", out);
+
+	print("9de-iconindex: %d icons -> %s\n", ui9icon_indexlen(x), out);
+	ui9icon_indexfree(x);
+	exits(nil);
+}
@@ -0,0 +1,270 @@
+#include <u.h>
+#include <libc.h>
+#include <draw.h>
+
+#include "../../include/9deui/9deui.h"
+
+/*
+ * 9de-iconpack — compile an icon tree into one pack file.
+ *
+ * Reads
+ *   <root>/<app>/<size>/icon.bit
+ *   <root>/<app>/icon.bit          (size 0)
+ * and writes <root>/icons.pack (see include/9deui/icon.h for the format):
+ * a text index followed by a single compressed atlas image, so lib9deui
+ * loads every icon with one open and one readimage.
+ *
+ * Usage:
+ *   9de-iconpack [-w atlaswidth] [-o out] [root]
+ *
+ * root defaults to $home/lib/9de/icons. Needs a display (uses libdraw
+ * to compose and compress the atlas); run it from rio.
+ */
+
+enum {
+	DefWidth = 1024,
+	MaxIcons = 4096,
+};
+
+typedef struct Ent Ent;
+struct Ent {
+	char *app;
+	int size;
+	Image *img;
+	Rectangle r;    /* placement in the atlas */
+};
+
+static Ent ents[MaxIcons];
+static int nents;
+
+static char*
+home(void)
+{
+	char *h = getenv("home");
+	return h ? h : "/usr/glenda";
+}
+
+static void
+usage(void)
+{
+	fprint(2, "usage: 9de-iconpack [-w atlaswidth] [-o out] [root]\n");
+	exits("usage");
+}
+
+static void
+addicon(char *path, char *app, int size)
+{
+	int fd;
+	Image *img;
+
+	if(nents >= MaxIcons){
+		fprint(2, "9de-iconpack: too many icons, skipping %s\n", path);
+		return;
+	}
+	fd = open(path, OREAD);
+	if(fd < 0)
+		return;
+	img = readimage(display, fd, 0);
+	close(fd);
+	if(img == nil){
+		fprint(2, "9de-iconpack: %s: %r\n", path);
+		return;
+	}
+	ents[nents].app = strdup(app);
+	ents[nents].size = size;
+	ents[nents].img = img;
+	nents++;
+}
+
+static int
+isnum(char *s)
+{
+	if(*s == 0)
+		return 0;
+	for(; *s; s++)
+		if(*s < '0' || *s > '9')
+			return 0;
+	return 1;
+}
+
+static void
+scanapp(char *root, char *app)
+{
+	char dir[512], p[512];
+	Dir *d;
+	int fd, n, i;
+
+	snprint(dir, sizeof dir, "%s/%s", root, app);
+	snprint(p, sizeof p, "%s/icon.bit", dir);
+	addicon(p, app, 0);
+
+	fd = open(dir, OREAD);
+	if(fd < 0)
+		return;
+	n = dirreadall(fd, &d);
+	close(fd);
+	for(i=0; i<n; i++){
+		if(!(d[i].qid.type & QTDIR) || !isnum(d[i].name))
+			continue;
+		snprint(p, sizeof p, "%s/%s/icon.bit", dir, d[i].name);
+		addicon(p, app, atoi(d[i].name));
+	}
+	free(d);
+}
+
+static void
+scanroot(char *root)
+{
+	Dir *d;
+	int fd, n, i;
+
+	fd = open(root, OREAD);
+	if(fd < 0)
+		sysfatal("open %s: %r", root);
+	n = dirreadall(fd, &d);
+	close(fd);
+	for(i=0; i<n; i++){
+		if(!(d[i].qid.type & QTDIR))
+			continue;
+		if(strcmp(d[i].name, "cache") == 0)
+			continue;
+		scanapp(root, d[i].name);
+	}
+	free(d);
+}
+
+/* tallest first keeps shelves tight */
+static int
+bytall(void *va, void *vb)
+{
+	Ent *a = va, *b = vb;
+	return Dy(b->img->r) - Dy(a->img->r);
+}
+
+/* shelf packing; returns atlas height */
+static int
+place(int width)
+{
+	int i, x, y, shelfh, w, h;
+
+	qsort(ents, nents, sizeof ents[0], bytall);
+	x = y = shelfh = 0;
+	for(i=0; i<nents; i++){
+		w = Dx(ents[i].img->r);
+		h = Dy(ents[i].img->r);
+		if(w > width)
+			sysfatal("%s/%d is %dpx wide, atlas is %d", ents[i].app, ents[i].size, w, width);
+		if(x + w > width){
+			x = 0;
+			y += shelfh;
+			shelfh = 0;
+		}
+		ents[i].r = Rect(x, y, x+w, y+h);
+		x += w;
+		if(h > shelfh)
+			shelfh = h;
+	}
+	return y + shelfh;
+}
+
+static char*
+mkindex(int *len)
+{
+	char *buf, *p, *e;
+	int i, cap;
+
+	/* the name plus five ints of at most 11 chars and their separators */
+	cap = 1;
+	for(i=0; i<nents; i++)
+		cap += strlen(ents[i].app) + 5*12 + 1;
+	buf = malloc(cap);
+	if(buf == nil)
+		sysfatal("malloc: %r");
+	p = buf;
+	e = buf + cap;
+	for(i=0; i<nents; i++){
+		p = seprint(p, e, "%s %d %d %d %d %d\n", ents[i].app, ents[i].size,
+			ents[i].r.min.x, ents[i].r.min.y, ents[i].r.max.x, ents[i].r.max.y);
+		if(p >= e-1)
+			sysfatal("index overflow at %s/%d", ents[i].app, ents[i].size);
+	}
+	*len = p - buf;
+	return buf;
+}
+
+void
+main(int argc, char **argv)
+{
+	char *root, *out, *idx, tmp[512], hdr[Ui9IconPackHdr+1];
+	char rootbuf[512], outbuf[512];
+	int width, height, fd, nidx, i;
+	Image *atlas;
+	Dir nd;
+
+	width = DefWidth;
+	out = nil;
+	ARGBEGIN{
+	case 'w':
+		width = atoi(EARGF(usage()));
+		break;
+	case 'o':
+		out = EARGF(usage());
+		break;
+	default:
+		usage();
+	}ARGEND
+
+	if(argc > 1)
+		usage();
+	if(argc == 1)
+		root = argv[0];
+	else{
+		snprint(rootbuf, sizeof rootbuf, "%s/lib/9de/icons", home());
+		root = rootbuf;
+	}
+	if(out == nil){
+		snprint(outbuf, sizeof outbuf, "%s/icons.pack", root);
+		out = outbuf;
+	}
+	if(width < 16)
+		usage();
+
+	if(initdraw(0, 0, "9de-iconpack") < 0)
+		sysfatal("initdraw: %r");
+
+	scanroot(root);
+	if(nents == 0)
+		sysfatal("no icons under %s", root);
+
+	height = place(width);
+	atlas = allocimage(display, Rect(0, 0, width, height), RGBA32, 0, DTransparent);
+	if(atlas == nil)
+		sysfatal("allocimage %dx%d: %r", width, height);
+	for(i=0; i<nents; i++)
+		draw(atlas, ents[i].r, ents[i].img, nil, ents[i].img->r.min);
+
+	idx = mkindex(&nidx);
+	snprint(hdr, sizeof hdr, "%s %11d\n", UI9ICONPACK, nidx);
+
+	/* write next to the target and rename, so readers never see a partial pack */
+	snprint(tmp, sizeof tmp, "%s.new", out);
+	fd = create(tmp, OWRITE, 0644);
+	if(fd < 0)
+		sysfatal("create %s: %r", tmp);
+	if(write(fd, hdr, Ui9IconPackHdr) != Ui9IconPackHdr
+	|| write(fd, idx, nidx) != nidx
+	|| writeimage(fd, atlas, 0) < 0){
+		close(fd);
+		remove(tmp);
+		sysfatal("write %s: %r", tmp);
+	}
+	close(fd);
+	nulldir(&nd);
+	nd.name = strrchr(out, '/') ? strrchr(out, '/')+1 : out;
+	remove(out);
+	if(dirwstat(tmp, &nd) < 0)
+		sysfatal("rename %s: %r", tmp);
+
+	print("9de-iconpack: %d icons, atlas %dx%d -> %s\n", nents, width, height, out);
+	exits(nil);
+}
@@ -2,7 +2,9 @@
 #include <libc.h>
 #include <draw.h>
 #include <event.h>
+#include <keyboard.h>
 #include <bio.h>
+#include <pool.h>
 
 #include "../../include/9deui/9deui.h"
 
@@ -14,6 +16,8 @@
  *
  * Panel layout tokens:
  *   panel_pad, panel_gap, panel_chip, panel_ws_maxw, panel_win_maxw
+ *   panel_netifc="0 1"    (/net/ipifc/N shown by the net module)
+ *   panel_ext="name:refreshms:timeoutms[:path] ..."  (external modules)
  *
  * Appearance (preset-based):
  *   ui_style=terminal|dark|glass
@@ -37,27 +41,83 @@
  * Defaults:
  *   gradients ON (subtle), chips-on-hover ON, rounded corners are small.
  *
+ * Debug:
+ *   panel_stats=1         (draw ops + input events read/merged per frame on stderr)
+ *   9de-panel -b trace    (replay a trace offscreen, CSV per frame on stdout; see benchmain)
+ *
+ * Expand/collapse:
+ *   panel_expand_ms=150   (hover time on ws before the mini list opens)
+ *   panel_collapse_ms=400 (time away from ws + mini list before it closes)
+ *
  * Still OS-level:
- * - reads /dev/wsys/* for labels
+ * - window list from /mnt/9de/windows when 9de-shell publishes it,
+ *   else reads /dev/wsys/* itself
  * - focuses by writing "current" to /dev/wsys/<id>/wctl
- * - best-effort mounts /srv/9de to /mnt/9de and watches /mnt/9de/events (in helper proc)
+ * - mounts /srv/9de on /mnt/9de and watches /mnt/9de/events from a helper
+ *   proc that reconnects with backoff and hands lines to the event loop
  */
 
 enum { MaxMods = 24 };
+enum { MaxSrc = 16 };
+enum { MaxExt = 8 };
 enum { PanelHDefault = 34 };
 enum { MiniHDefault  = 28 };
 enum { MaxStr = 128 };
-enum { MaxWins = 16 };
 enum { MaxGrad = 256 };
+enum { TickMs = 250 };   /* event loop wakeup; clock + window polling */
+enum { MaxDamage = MaxMods + 4 };
+enum { HoverSlack = 6 };   /* px around the ws chip that still count as hovering it */
+enum { WatchMinMs = 250, WatchMaxMs = 8000, WatchMsg = 512 };   /* /srv/9de watcher */
+enum { BenchW = 1280 };  /* -b: offscreen panel width */
+enum { MaxNotes = 128, NotesRows = 6 };   /* notification ring, rows shown */
+
+/* hit-test ids registered while drawing (ui9_hitadd) */
+enum {
+	HitMod  = 1<<24,   /* | side<<8 | index into leftmods/rightmods */
+	HitWin  = 2<<24,   /* | window id, minibar chips */
+	HitKind = 0xFF<<24,
+};
 
 typedef struct Panel Panel;
 typedef struct Pmod Pmod;
 typedef struct WinEnt WinEnt;
+typedef struct Psrc Psrc;
+typedef struct Pext Pext;
+typedef struct Pnote Pnote;
 
 struct WinEnt {
 	int id;
 	int current;
 	char label[MaxStr];
+	char chip[MaxStr];  /* "id label", fitted to panel_win_maxw (winlayout) */
+	int w;              /* chip width */
+	int x;              /* chip offset in the minibar strip */
+};
+
+/* one notification; a burst of identical ones is one entry */
+struct Pnote {
+	char text[MaxStr];
+	int n;              /* repeats */
+	long first, last;   /* seconds */
+};
+
+struct Psrc {
+	char name[16];
+	char path[128];
+	long ms;            /* poll interval */
+	void (*parse)(Panel*, Psrc*, char*, int);   /* n < 0: file absent */
+	char val[MaxStr];   /* parser output */
+
+	int fd;             /* held open, -1 until the next poll reopens it */
+	int bound;
+	vlong due;
+	uvlong hash;        /* of the last bytes read */
+
+	ulong polls;        /* cost, panel_stats=1 */
+	ulong reads;
+	ulong opens;
+	ulong parses;
+	vlong ns;
 };
 
 struct Panel {
@@ -71,6 +131,17 @@ struct Panel {
 	int minih;
 	int h;
 	int expanded;
+	int expandms;      /* hover must hold this long to expand ... */
+	int collapsems;    /* ... and be gone this long to collapse */
+	int xpend;         /* a transition is waiting out its delay */
+	vlong xdue;
+	int rzn;           /* resizes written this minute, panel_stats=1 */
+	int rzlast;        /* ... and in the last full minute */
+	vlong rzmin;       /* start of this minute */
+	ulong bufallocs;   /* back buffer (re)allocations */
+	int bench;         /* -b: offscreen replay, no wctl/wsys/srv/ext */
+	vlong benchms;     /* trace time, the panel's clock under -b */
+	long flushed;      /* bytes in the last frame's final flushimage */
 
 	/* panel layout tokens (changeable) */
 	int pad;
@@ -81,7 +152,20 @@ struct Panel {
 
 	/* runtime */
 	int dirty;
+	int remeasure;     /* a label changed: run module measure before drawing */
+	int full;          /* next frame repaints and blits everything */
+	int minidirty;     /* minibar needs a repaint */
+	int sidedirty[2];  /* a module width changed: repaint that stack (0 left, 1 right) */
+	Rectangle span[2]; /* each stack's extent in the last frame */
+	Rectangle lastr;   /* window rect of the last frame */
+	Rectangle dmg[MaxDamage];  /* rects repainted this frame, blitted one by one */
+	int ndmg;
+	long blitpx;       /* pixels blitted by the last frame */
+	ulong hoverid;     /* ui9_hit under the pointer at the last mouse event */
 	int ascii;
+	int stats;         /* panel_stats=1: log draw ops per frame to stderr */
+	ulong frameops;    /* draw ops of the last frame */
+	Ui9Events ev;      /* input batch of the current frame */
 	Point mousexy;
 	int mousebuttons;
 
@@ -102,12 +186,40 @@ struct Panel {
 	char net_label[MaxStr];
 	char clock_label[MaxStr];
 	char preset_label[MaxStr];
-	int notif_count;
+	int notif_count;   /* unseen notifications */
+	char notif_label[MaxStr];
+	Pnote notes[MaxNotes];     /* ring, newest at (notehead-1) % MaxNotes */
+	ulong notehead;    /* entries ever pushed */
+	ulong coalesced;   /* notifications folded into the previous entry */
+	int notesopen;     /* the list is shown below the bar */
+	int xnotes;        /* notesopen at the last expand/collapse */
+	int notescroll;    /* rows scrolled back from the newest */
+	Psrc src[MaxSrc];
+	int nsrc;
+	Pext *ext[MaxExt];
+	int next;
+	char ext_running[256];     /* panel_ext the helpers were started for */
 
 	/* window model */
 	char ws_label[MaxStr];
-	WinEnt wins[MaxWins];
+	Ui9Wsys *wsys;     /* incremental /dev/wsys table; wins is a copy */
+	int winsrv;        /* 9de-shell publishes windows: no local polling */
+	int winsync;       /* a "win" event arrived: reread /mnt/9de/windows */
+	ulong watchkey;    /* estart key of the watcher pipe, 0 if not watching */
+	int srvups;        /* reconnects since start */
+	int srvlost;       /* resyncs after "lost N" */
+	ulong srvevents;
+	vlong srvlag;      /* sum of ms from the watcher's read to handling */
+	vlong srvlagmax;
+	WinEnt *wins;      /* grows with the session */
 	int nwins;
+	int awins;
+	int winslaid;      /* chip texts, widths and offsets are current */
+	int stripw;        /* all chips, gaps included */
+	int stripvis;      /* visible strip width in the last minibar */
+	int winscroll;     /* px the strip is scrolled left */
+	int winsel;        /* keyboard selection, -1 if none */
+	int wincur;        /* current id the strip was last scrolled to */
 	int ws_hover;
 	int ws_hover_id;
 
@@ -124,6 +236,8 @@ struct Panel {
 	int ui_shadow_alpha;    /* -1 if unset */
 	int ui_radius;          /* -1 if unset */
 	char ui_font_path[256];
+	Font *font;         /* cached override, nil: display default */
+	char fontpath[256]; /* ui_font_path font was last resolved for */
 
 	/* gradient config + cache */
 	int ui_topgrad;         /* 1 on */
@@ -146,6 +260,8 @@ struct Panel {
 	/* config */
 	char panel_left_cfg[256];
 	char panel_right_cfg[256];
+	char panel_netifc[64];     /* interfaces the net module shows */
+	char panel_ext[256];       /* external modules, see startext */
 	int enable_watch;
 };
 
@@ -161,6 +277,32 @@ struct Pmod {
 	int  (*hit)(Panel*, Pmod*, Mouse*, Rectangle);
 
 	Rectangle last;
+	int dirty;       /* repaint just this module's column next frame */
+	Pext *ext;       /* external module behind it, nil for built-ins */
+};
+
+struct Pext {
+	Pmod mod;
+	char name[32];
+	char path[256];
+	long ms;            /* refresh */
+	long timeout;       /* budget per run */
+	int quit;           /* set by the UI proc; the helper exits and frees */
+
+	Lock lk;            /* the helper's results */
+	char got[MaxStr];   /* last good label */
+	int gotstate;
+	int late;           /* last run blew the budget */
+	vlong lastns;
+	ulong runs;
+	ulong lates;
+	ulong seq;
+
+	ulong seen;         /* UI proc only from here */
+	char label[MaxStr];
+	int state;
+	int flagged;
+	vlong avgns;
 };
 
 /* ----------------- helpers ----------------- */
@@ -172,6 +314,45 @@ home(void)
 	return h ? h : "/usr/glenda";
 }
 
+/* label text changed: widths may have too */
+static void
+marklabels(Panel *p)
+{
+	p->winslaid = 0;   /* font or theme may have changed */
+	p->remeasure = 1;
+	p->dirty = 1;
+	p->full = 1;
+}
+
+static char* modlabel(Panel*, Pmod*);
+
+/* copy s into a label; only the modules showing it are repainted */
+static int
+setlabel(Panel *p, char *dst, int n, char *s)
+{
+	int i, shown;
+
+	if(strcmp(dst, s) == 0)
+		return 0;
+	strecpy(dst, dst+n, s);
+	shown = 0;
+	for(i=0; i<p->nleft; i++)
+		if(modlabel(p, p->leftmods[i]) == dst){
+			p->leftmods[i]->dirty = 1;
+			shown = 1;
+		}
+	for(i=0; i<p->nright; i++)
+		if(modlabel(p, p->rightmods[i]) == dst){
+			p->rightmods[i]->dirty = 1;
+			shown = 1;
+		}
+	if(shown){
+		p->remeasure = 1;
+		p->dirty = 1;
+	}
+	return 1;
+}
+
 static void
 spawnrc(char *cmd)
 {
@@ -191,6 +372,30 @@ ensurelogdir(void)
 	mkdir(p);
 }
 
+static ulong nimg;   /* allocimage calls, reported by -b */
+
+/* notification list height: NotesRows rows of text */
+static int
+notesh(Panel *p)
+{
+	Font *f = p->ui.font ? p->ui.font : font;
+
+	return NotesRows*(f->height+4) + 4;
+}
+
+/* height below the bar while expanded: the mini list or the notifications */
+static int
+expandh(Panel *p)
+{
+	return p->notesopen ? notesh(p) : p->minih;
+}
+
+static int
+expandmax(Panel *p)
+{
+	return p->baseh + (notesh(p) > p->minih ? notesh(p) : p->minih);
+}
+
 /* smooth: offscreen buffer */
 static void
 bufrealloc(Panel *p)
@@ -200,79 +405,33 @@ bufrealloc(Panel *p)
 	if(p->dst == nil)
 		return;
 
+	/*
+	 * same origin as the window (panel coordinates are screen
+	 * coordinates), expanded height: expand/collapse reuse it
+	 */
 	r = p->dst->r;
+	if(Dy(r) < expandmax(p))
+		r.max.y = r.min.y + expandmax(p);
 	if(p->buf != nil){
-		if(Dx(p->buf->r) == Dx(r) && Dy(p->buf->r) == Dy(r))
+		if(eqrect(p->buf->r, r))
 			return;
 		freeimage(p->buf);
 		p->buf = nil;
 	}
 
-	p->buf = allocimage(display, Rect(0,0,Dx(r),Dy(r)), p->dst->chan, 0, 0x00000000);
+	p->buf = allocimage(display, r, p->dst->chan, 0, 0x00000000);
+	p->bufallocs++;
+	nimg++;
 }
 
 /* ----------------- basic string helpers ----------------- */
 
-static void
-chomp(char *s)
-{
-	int n = strlen(s);
-	while(n > 0 && (s[n-1] == '\n' || s[n-1] == '\r' || s[n-1] == ' ' || s[n-1] == '\t'))
-		s[--n] = 0;
-}
-
 static char*
 sym(Panel *p, char *utf8, char *ascii)
 {
 	return p->ascii ? ascii : utf8;
 }
 
-/* ----------------- config parser ----------------- */
-
-static int isws(int c){ return c==' ' || c=='\t' || c=='\r' || c=='\n'; }
-
-static void
-trim(char *s)
-{
-	char *p, *e;
-	while(*s && isws(*s)) s++;
-	if(s[0] != 0){
-		p = s;
-		while(isws(*p)) p++;
-		if(p != s) memmove(s, p, strlen(p)+1);
-	}
-	e = s + strlen(s);
-	while(e > s && isws(e[-1])) e--;
-	*e = 0;
-}
-
-static void
-stripquotes(char *s)
-{
-	int n = strlen(s);
-	if(n >= 2 && ((s[0]=='"' && s[n-1]=='"') || (s[0]=='\'' && s[n-1]=='\''))){
-		memmove(s, s+1, n-2);
-		s[n-2] = 0;
-	}
-}
-
-static void
-normalize_list(char *v)
-{
-	trim(v);
-	stripquotes(v);
-	trim(v);
-
-	if(v[0] == '('){
-		char *e = v + strlen(v) - 1;
-		if(e > v && *e == ')'){
-			memmove(v, v+1, (e - (v+1)));
-			v[e - (v+1)] = 0;
-			trim(v);
-		}
-	}
-}
-
 /* ----------------- color helpers (hex + rgb ops) ----------------- */
 
 static int
@@ -366,6 +525,7 @@ freegrad(Image **a, int n)
 static Image*
 mk1x1rgb24(ulong rgb)
 {
+	nimg++;
 	return allocimage(display, Rect(0,0,1,1), RGB24, 1, rgb);
 }
 
@@ -398,7 +558,8 @@ ensurevgrad(Image **a, int *pn, ulong *pc0, ulong *pc1, int *ph, int h, ulong c0
 	*ph = h;
 }
 
-static void
+/* returns the number of draw ops issued */
+static int
 drawvgrad(Image *dst, Rectangle r, Image **a, int n)
 {
 	int y, h;
@@ -409,183 +570,138 @@ drawvgrad(Image *dst, Rectangle r, Image **a, int n)
 		Rectangle rr = Rect(r.min.x, r.min.y + y, r.max.x, r.min.y + y + 1);
 		draw(dst, rr, a[y], nil, ZP);
 	}
+	return h;
 }
 
 /* ----------------- load config ----------------- */
 
-static void
-loadconfig(Panel *p)
-{
-	char path[256];
-	Biobuf *b;
-	char *ln;
-	int fd;
-
-	snprint(path, sizeof path, "%s/lib/9de/config.rc", home());
-	fd = open(path, OREAD);
-	if(fd < 0)
-		return;
-
-	b = Bfdopen(fd, OREAD);
-	if(b == nil){
-		close(fd);
-		return;
-	}
+/* ----------------- reload helpers ----------------- */
 
-	for(;;){
-		ln = Brdline(b, '\n');
-		if(ln == nil)
-			break;
-		ln[Blinelen(b)-1] = 0;
+/* config.rc keys (lib/cfg.c); unset heights fall back to the enums */
+static Ui9CfgKey panelkeys[] = {
+	{ "panel_left",      Ui9CfgStr,  "menu ws" },
+	{ "panel_right",     Ui9CfgStr,  "preset de net clock notif" },
+	{ "panel_height",    Ui9CfgInt,  nil },
+	{ "panel_minih",     Ui9CfgInt,  nil },
+	{ "panel_expand_ms", Ui9CfgInt,  "150", 0, 5000 },
+	{ "panel_collapse_ms", Ui9CfgInt, "400", 0, 5000 },
+	{ "panel_ascii",     Ui9CfgBool, "0" },
+	{ "panel_stats",     Ui9CfgBool, "0" },
+	{ "panel_watch",     Ui9CfgBool, "1" },
+	{ "panel_pad",       Ui9CfgInt,  "10", 0, 64 },
+	{ "panel_gap",       Ui9CfgInt,  "8", 0, 64 },
+	{ "panel_chip",      Ui9CfgBool, "1" },
+	{ "panel_ws_maxw",   Ui9CfgInt,  "140", 40, 4096 },
+	{ "panel_win_maxw",  Ui9CfgInt,  "240", 60, 4096 },
+	{ "panel_netifc",    Ui9CfgStr,  "0 1" },
+	{ "panel_ext",       Ui9CfgStr,  "" },
+
+	/* appearance; unset means "theme default" */
+	{ "ui_style",        Ui9CfgStr,  "" },
+	{ "ui_alpha",        Ui9CfgInt,  "-1", -1, 255 },
+	{ "ui_accent",       Ui9CfgStr,  "" },
+	{ "ui_topbg",        Ui9CfgStr,  "" },
+	{ "ui_toptext",      Ui9CfgStr,  "" },
+	{ "ui_border_alpha", Ui9CfgInt,  "-1", -1, 255 },
+	{ "ui_shadow_alpha", Ui9CfgInt,  "-1", -1, 255 },
+	{ "ui_radius",       Ui9CfgInt,  "-1", -1, 24 },
+	{ "ui_font",         Ui9CfgStr,  "" },
 
-		{
-			char *c = strchr(ln, '#');
-			if(c) *c = 0;
-		}
-		trim(ln);
-		if(ln[0] == 0)
-			continue;
+	/* gradients */
+	{ "ui_topgrad",      Ui9CfgBool, "0" },
+	{ "ui_topgrad0",     Ui9CfgStr,  "#0c0c0e" },
+	{ "ui_topgrad1",     Ui9CfgStr,  "#1a1a20" },
+	{ "ui_minigrad",     Ui9CfgBool, "0" },
+	{ "ui_minigrad0",    Ui9CfgStr,  "#101014" },
+	{ "ui_minigrad1",    Ui9CfgStr,  "#18181f" },
+};
 
-		{
-			char *eq = strchr(ln, '=');
-			char key[64], val[256];
-			int klen;
-
-			if(eq == nil) continue;
-			klen = eq - ln;
-			if(klen <= 0 || klen >= (int)sizeof key) continue;
-
-			memmove(key, ln, klen);
-			key[klen] = 0;
-			snprint(val, sizeof val, "%s", eq+1);
-
-			trim(key);
-			trim(val);
-			normalize_list(val);
-
-			/* panel layout */
-			if(strcmp(key, "panel_left") == 0){
-				strecpy(p->panel_left_cfg, p->panel_left_cfg+sizeof p->panel_left_cfg, val);
-			}else if(strcmp(key, "panel_right") == 0){
-				strecpy(p->panel_right_cfg, p->panel_right_cfg+sizeof p->panel_right_cfg, val);
-			}else if(strcmp(key, "panel_height") == 0){
-				p->baseh = atoi(val);
-				if(p->baseh <= 16) p->baseh = PanelHDefault;
-			}else if(strcmp(key, "panel_minih") == 0){
-				p->minih = atoi(val);
-				if(p->minih < 16) p->minih = MiniHDefault;
-			}else if(strcmp(key, "panel_ascii") == 0){
-				p->ascii = atoi(val) != 0;
-			}else if(strcmp(key, "panel_watch") == 0){
-				p->enable_watch = atoi(val) != 0;
-			}else if(strcmp(key, "panel_pad") == 0){
-				p->pad = atoi(val);
-			}else if(strcmp(key, "panel_gap") == 0){
-				p->gap = atoi(val);
-			}else if(strcmp(key, "panel_chip") == 0){
-				p->chip = atoi(val) != 0;
-			}else if(strcmp(key, "panel_ws_maxw") == 0){
-				p->ws_maxw = atoi(val);
-			}else if(strcmp(key, "panel_win_maxw") == 0){
-				p->win_maxw = atoi(val);
-			}
+/* defaults < defaults.rc < config.rc < env, in one pass */
+static void
+loadcfg(Panel *p)
+{
+	Ui9Cfg *c;
+
+	c = ui9cfg_load(panelkeys, nelem(panelkeys), 1);
+
+	ui9cfg_strcpy(c, "panel_left", p->panel_left_cfg, sizeof p->panel_left_cfg);
+	ui9cfg_strcpy(c, "panel_right", p->panel_right_cfg, sizeof p->panel_right_cfg);
+	p->baseh = ui9cfg_int(c, "panel_height");
+	p->minih = ui9cfg_int(c, "panel_minih");
+	p->expandms = ui9cfg_int(c, "panel_expand_ms");
+	p->collapsems = ui9cfg_int(c, "panel_collapse_ms");
+	p->ascii = ui9cfg_bool(c, "panel_ascii");
+	p->stats = ui9cfg_bool(c, "panel_stats");
+	p->enable_watch = ui9cfg_bool(c, "panel_watch");
+	p->pad = ui9cfg_int(c, "panel_pad");
+	p->gap = ui9cfg_int(c, "panel_gap");
+	p->chip = ui9cfg_bool(c, "panel_chip");
+	p->ws_maxw = ui9cfg_int(c, "panel_ws_maxw");
+	p->win_maxw = ui9cfg_int(c, "panel_win_maxw");
+	ui9cfg_strcpy(c, "panel_netifc", p->panel_netifc, sizeof p->panel_netifc);
+	ui9cfg_strcpy(c, "panel_ext", p->panel_ext, sizeof p->panel_ext);
+
+	ui9cfg_strcpy(c, "ui_style", p->ui_style_name, sizeof p->ui_style_name);
+	p->ui_alpha = ui9cfg_int(c, "ui_alpha");
+	ui9cfg_strcpy(c, "ui_accent", p->ui_accent, sizeof p->ui_accent);
+	ui9cfg_strcpy(c, "ui_topbg", p->ui_topbg, sizeof p->ui_topbg);
+	ui9cfg_strcpy(c, "ui_toptext", p->ui_toptext, sizeof p->ui_toptext);
+	p->ui_border_alpha = ui9cfg_int(c, "ui_border_alpha");
+	p->ui_shadow_alpha = ui9cfg_int(c, "ui_shadow_alpha");
+	p->ui_radius = ui9cfg_int(c, "ui_radius");
+	ui9cfg_strcpy(c, "ui_font", p->ui_font_path, sizeof p->ui_font_path);
+
+	p->ui_topgrad = ui9cfg_bool(c, "ui_topgrad");
+	ui9cfg_strcpy(c, "ui_topgrad0", p->ui_topgrad0, sizeof p->ui_topgrad0);
+	ui9cfg_strcpy(c, "ui_topgrad1", p->ui_topgrad1, sizeof p->ui_topgrad1);
+	p->ui_minigrad = ui9cfg_bool(c, "ui_minigrad");
+	ui9cfg_strcpy(c, "ui_minigrad0", p->ui_minigrad0, sizeof p->ui_minigrad0);
+	ui9cfg_strcpy(c, "ui_minigrad1", p->ui_minigrad1, sizeof p->ui_minigrad1);
+
+	ui9cfg_free(c);
 
-			/* appearance */
-			else if(strcmp(key, "ui_style") == 0){
-				strecpy(p->ui_style_name, p->ui_style_name+sizeof p->ui_style_name, val);
-			}else if(strcmp(key, "ui_alpha") == 0){
-				p->ui_alpha = atoi(val);
-			}else if(strcmp(key, "ui_accent") == 0){
-				strecpy(p->ui_accent, p->ui_accent+sizeof p->ui_accent, val);
-			}else if(strcmp(key, "ui_topbg") == 0){
-				strecpy(p->ui_topbg, p->ui_topbg+sizeof p->ui_topbg, val);
-			}else if(strcmp(key, "ui_toptext") == 0){
-				strecpy(p->ui_toptext, p->ui_toptext+sizeof p->ui_toptext, val);
-			}else if(strcmp(key, "ui_border_alpha") == 0){
-				p->ui_border_alpha = atoi(val);
-			}else if(strcmp(key, "ui_shadow_alpha") == 0){
-				p->ui_shadow_alpha = atoi(val);
-			}else if(strcmp(key, "ui_radius") == 0){
-				p->ui_radius = atoi(val);
-			}else if(strcmp(key, "ui_font") == 0){
-				strecpy(p->ui_font_path, p->ui_font_path+sizeof p->ui_font_path, val);
-			}
+	if(p->baseh <= 16) p->baseh = PanelHDefault;
+	if(p->minih < 16)  p->minih = MiniHDefault;
+	p->h = p->baseh;
 
-			/* gradients */
-			else if(strcmp(key, "ui_topgrad") == 0){
-				p->ui_topgrad = atoi(val) != 0;
-			}else if(strcmp(key, "ui_topgrad0") == 0){
-				strecpy(p->ui_topgrad0, p->ui_topgrad0+sizeof p->ui_topgrad0, val);
-			}else if(strcmp(key, "ui_topgrad1") == 0){
-				strecpy(p->ui_topgrad1, p->ui_topgrad1+sizeof p->ui_topgrad1, val);
-			}else if(strcmp(key, "ui_minigrad") == 0){
-				p->ui_minigrad = atoi(val) != 0;
-			}else if(strcmp(key, "ui_minigrad0") == 0){
-				strecpy(p->ui_minigrad0, p->ui_minigrad0+sizeof p->ui_minigrad0, val);
-			}else if(strcmp(key, "ui_minigrad1") == 0){
-				strecpy(p->ui_minigrad1, p->ui_minigrad1+sizeof p->ui_minigrad1, val);
-			}
-		}
+	/* -b replays a trace: no helper procs */
+	if(p->bench){
+		p->enable_watch = 0;
+		p->panel_ext[0] = 0;
 	}
-
-	Bterm(b);
 }
 
+/* glyphs the modules draw besides ascii */
+static char panelglyphs[] = "≡▦•…⌛";
 
-/* ----------------- reload helpers ----------------- */
-
+/* font override through the shared cache: an unchanged path costs nothing */
 static void
-setcfgdefaults(Panel *p)
+applyfont(Panel *p, Font *fnt)
 {
-	/* base defaults (keep runtime state elsewhere) */
-	p->baseh = PanelHDefault;
-	p->minih = MiniHDefault;
-	p->h = p->baseh;
-
-	/* layout tokens */
-	p->pad = 10;
-	p->gap = 8;
-	p->chip = 1;
-	p->ws_maxw = 140;
-	p->win_maxw = 240;
-
-	p->ascii = 0;
-	p->enable_watch = 1;
-
-	/* appearance defaults (unset means "theme default") */
-	p->ui_style_name[0] = 0;
-	p->ui_alpha = -1;
-	p->ui_accent[0] = 0;
-	p->ui_topbg[0] = 0;
-	p->ui_toptext[0] = 0;
-	p->ui_border_alpha = -1;
-	p->ui_shadow_alpha = -1;
-	p->ui_radius = -1;
-	p->ui_font_path[0] = 0;
-
-	/* gradients */
-	p->ui_topgrad = 0;
-	strecpy(p->ui_topgrad0, p->ui_topgrad0+sizeof p->ui_topgrad0, "#0c0c0e");
-	strecpy(p->ui_topgrad1, p->ui_topgrad1+sizeof p->ui_topgrad1, "#1a1a20");
-
-	p->ui_minigrad = 0;
-	strecpy(p->ui_minigrad0, p->ui_minigrad0+sizeof p->ui_minigrad0, "#101014");
-	strecpy(p->ui_minigrad1, p->ui_minigrad1+sizeof p->ui_minigrad1, "#18181f");
+	Font *nf;
 
-	/* config strings */
-	strecpy(p->panel_left_cfg, p->panel_left_cfg+sizeof p->panel_left_cfg, "menu ws");
-	strecpy(p->panel_right_cfg, p->panel_right_cfg+sizeof p->panel_right_cfg, "preset de net clock notif");
+	if(strcmp(p->ui_font_path, p->fontpath) == 0)
+		return;
+	strecpy(p->fontpath, p->fontpath+sizeof p->fontpath, p->ui_font_path);
+	nf = nil;
+	if(p->ui_font_path[0] != 0){
+		nf = ui9font_open(display, p->ui_font_path);
+		if(nf == nil){
+			fprint(2, "9de-panel: openfont %s failed: %r\n", p->ui_font_path);
+			return;
+		}
+		ui9font_preload(nf, panelglyphs);
+	}
+	ui9setfont(&p->ui, nf != nil ? nf : fnt);
+	ui9font_put(p->font);
+	p->font = nf;
+	marklabels(p);
 }
 
 static void
 applyappearance(Panel *p, Font *fnt)
 {
-	/* optional font override */
-	if(p->ui_font_path[0] != 0){
-		Font *nf = openfont(display, p->ui_font_path);
-		if(nf != nil)
-			fnt = nf;
-	}
+	applyfont(p, fnt);
 
 	/* ui already inited; update theme tokens */
 	if(p->ui_style_name[0] != 0)
@@ -617,6 +733,11 @@ applyappearance(Panel *p, Font *fnt)
 	ui9setdst(&p->ui, p->dst);
 }
 
+static void srcunbind(Panel*);
+static void srcsweep(Panel*);
+static void startext(Panel*);
+static int  findext(Panel*, char*, Pmod**);
+
 static void
 initmods(Panel *p)
 {
@@ -631,6 +752,8 @@ initmods(Panel *p)
 	}
 	p->nleft = 0;
 	p->nright = 0;
+	srcunbind(p);
+	startext(p);
 
 	ltmp = strdup(p->panel_left_cfg);
 	rtmp = strdup(p->panel_right_cfg);
@@ -644,14 +767,14 @@ initmods(Panel *p)
 
 	for(i=0; i<p->nleft; i++){
 		Pmod *m;
-		if(findmod(lw[i], &m)){
+		if(findmod(lw[i], &m) || findext(p, lw[i], &m)){
 			p->leftmods[i] = m;
 			if(m->init) m->init(p, m);
 		}
 	}
 	for(i=0; i<p->nright; i++){
 		Pmod *m;
-		if(findmod(rw[i], &m)){
+		if(findmod(rw[i], &m) || findext(p, rw[i], &m)){
 			p->rightmods[i] = m;
 			if(m->init) m->init(p, m);
 		}
@@ -659,48 +782,19 @@ initmods(Panel *p)
 
 	free(ltmp);
 	free(rtmp);
+	srcsweep(p);
 }
 
 static void
 reloadpanel(Panel *p, Font *fnt)
 {
-	/* reset config-related fields, then reload from file + env, then rebuild modules */
-	setcfgdefaults(p);
-	loadconfig(p);
-
-	/* env overrides (same behavior as boot) */
-	if(getenv("panel_left") != nil)   strecpy(p->panel_left_cfg, p->panel_left_cfg+sizeof p->panel_left_cfg, getenv("panel_left"));
-	if(getenv("panel_right") != nil)  strecpy(p->panel_right_cfg, p->panel_right_cfg+sizeof p->panel_right_cfg, getenv("panel_right"));
-	if(getenv("panel_height") != nil) p->baseh = atoi(getenv("panel_height"));
-	if(getenv("panel_minih") != nil)  p->minih = atoi(getenv("panel_minih"));
-	if(getenv("panel_ascii") != nil)  p->ascii = 1;
-
-	if(getenv("ui_style") != nil)     strecpy(p->ui_style_name, p->ui_style_name+sizeof p->ui_style_name, getenv("ui_style"));
-	if(getenv("ui_alpha") != nil)     p->ui_alpha = atoi(getenv("ui_alpha"));
-	if(getenv("ui_accent") != nil)    strecpy(p->ui_accent, p->ui_accent+sizeof p->ui_accent, getenv("ui_accent"));
-	if(getenv("ui_topbg") != nil)     strecpy(p->ui_topbg, p->ui_topbg+sizeof p->ui_topbg, getenv("ui_topbg"));
-	if(getenv("ui_toptext") != nil)   strecpy(p->ui_toptext, p->ui_toptext+sizeof p->ui_toptext, getenv("ui_toptext"));
-	if(getenv("ui_border_alpha") != nil) p->ui_border_alpha = atoi(getenv("ui_border_alpha"));
-	if(getenv("ui_shadow_alpha") != nil) p->ui_shadow_alpha = atoi(getenv("ui_shadow_alpha"));
-	if(getenv("ui_radius") != nil)    p->ui_radius = atoi(getenv("ui_radius"));
-	if(getenv("ui_font") != nil)      strecpy(p->ui_font_path, p->ui_font_path+sizeof p->ui_font_path, getenv("ui_font"));
-
-	if(getenv("ui_topgrad") != nil)   p->ui_topgrad = atoi(getenv("ui_topgrad")) != 0;
-	if(getenv("ui_topgrad0") != nil)  strecpy(p->ui_topgrad0, p->ui_topgrad0+sizeof p->ui_topgrad0, getenv("ui_topgrad0"));
-	if(getenv("ui_topgrad1") != nil)  strecpy(p->ui_topgrad1, p->ui_topgrad1+sizeof p->ui_topgrad1, getenv("ui_topgrad1"));
-
-	if(getenv("ui_minigrad") != nil)  p->ui_minigrad = atoi(getenv("ui_minigrad")) != 0;
-	if(getenv("ui_minigrad0") != nil) strecpy(p->ui_minigrad0, p->ui_minigrad0+sizeof p->ui_minigrad0, getenv("ui_minigrad0"));
-	if(getenv("ui_minigrad1") != nil) strecpy(p->ui_minigrad1, p->ui_minigrad1+sizeof p->ui_minigrad1, getenv("ui_minigrad1"));
-
-	if(p->baseh <= 16) p->baseh = PanelHDefault;
-	if(p->minih < 16)  p->minih = MiniHDefault;
-	p->h = p->baseh;
+	/* reload config (defaults, files, env), then rebuild modules */
+	loadcfg(p);
 
 	applyappearance(p, fnt);
 	initmods(p);
 	setpanelheight(p, p->h);
-	markdirty(p);
+	marklabels(p);
 }
 
 /* ----------------- model formatters ----------------- */
@@ -708,42 +802,12 @@ reloadpanel(Panel *p, Font *fnt)
 static void
 fmtclock(Panel *p)
 {
-	Tm *t = localtime(time(0));
-	snprint(p->clock_label, sizeof p->clock_label, "%02d:%02d:%02d", t->hour, t->min, t->sec);
-}
-
-static void
-fmtnet(Panel *p)
-{
-	char buf[1024];
-	char *ip, *s, *q;
-	int fd, n;
-
-	ip = nil;
-	fd = open("/net/ipifc/0/status", OREAD);
-	if(fd < 0)
-		fd = open("/net/ipifc/1/status", OREAD);
-	if(fd >= 0){
-		n = read(fd, buf, sizeof buf-1);
-		close(fd);
-		if(n > 0){
-			buf[n] = 0;
-			s = strstr(buf, "ip=");
-			if(s != nil){
-				s += 3;
-				q = s;
-				while(*q && *q!=' ' && *q!='\n' && (q-s) < 63) q++;
-				ip = smprint("%.*s", (int)(q-s), s);
-			}
-		}
-	}
+	Tm *t = localtime(p->bench ? p->benchms/1000 : time(0));
+	char buf[MaxStr];
 
-	if(ip != nil){
-		snprint(p->net_label, sizeof p->net_label, "%s", ip);
-		free(ip);
-	}else{
-		snprint(p->net_label, sizeof p->net_label, "net");
-	}
+	/* changes once a second: the only redraw of an idle panel */
+	snprint(buf, sizeof buf, "%02d:%02d:%02d", t->hour, t->min, t->sec);
+	setlabel(p, p->clock_label, sizeof p->clock_label, buf);
 }
 
 static void
@@ -751,10 +815,10 @@ fmtde(Panel *p)
 {
 	if(access("/srv/9de", AEXIST) == 0){
 		p->de_up = 1;
-		snprint(p->de_label, sizeof p->de_label, "de: ok");
+		setlabel(p, p->de_label, sizeof p->de_label, "de: ok");
 	}else{
 		p->de_up = 0;
-		snprint(p->de_label, sizeof p->de_label, "de: down");
+		setlabel(p, p->de_label, sizeof p->de_label, "de: down");
 	}
 }
 
@@ -762,183 +826,675 @@ static void
 fmtpreset(Panel *p)
 {
 	if(p->preset_label[0] == 0)
-		snprint(p->preset_label, sizeof p->preset_label, "style: terminal");
+		setlabel(p, p->preset_label, sizeof p->preset_label, "style: terminal");
 }
 
-/* text fitting */
-static void
-ellipsize(Panel *p, char *dst, int ndst, char *src, int maxpx, Font *f)
+/* ----------------- status sources ----------------- */
+
+/*
+ * A source is a file the panel rereads on an interval: its fd stays
+ * open, each poll is one pread at offset 0, and the parser runs only
+ * when the bytes hash differently from the last poll. Modules bind the
+ * sources they show from init; initmods drops the ones nobody bound.
+ */
+
+static uvlong
+srchash(char *s, int n)
 {
-	char tmp[MaxStr];
-	int n;
+	uvlong h;
 
-	if(src == nil){
-		dst[0] = 0;
-		return;
-	}
+	h = 14695981039346656037ULL;
+	while(n-- > 0)
+		h = (h ^ (uchar)*s++) * 1099511628211ULL;
+	return h;
+}
 
-	strecpy(tmp, tmp+sizeof tmp, src);
+static Psrc*
+srcbind(Panel *p, char *name, char *path, long ms, void (*parse)(Panel*, Psrc*, char*, int))
+{
+	Psrc *s;
+	int i;
 
-	if(stringwidth(f, tmp) <= maxpx){
-		strecpy(dst, dst+ndst, tmp);
-		return;
+	for(i=0; i<p->nsrc; i++)
+		if(strcmp(p->src[i].name, name) == 0)
+			break;
+	if(i == p->nsrc){
+		if(p->nsrc == MaxSrc)
+			return nil;
+		s = &p->src[p->nsrc++];
+		memset(s, 0, sizeof *s);
+		strecpy(s->name, s->name+sizeof s->name, name);
+		s->fd = -1;
 	}
-
-	for(n=strlen(tmp); n>0; n--){
-		tmp[n] = 0;
-		if(p->ascii)
-			snprint(dst, ndst, "%s...", tmp);
-		else
-			snprint(dst, ndst, "%s…", tmp);
-		if(stringwidth(f, dst) <= maxpx)
-			return;
+	s = &p->src[i];
+	if(strcmp(s->path, path) != 0){
+		if(s->fd >= 0)
+			close(s->fd);
+		s->fd = -1;
+		strecpy(s->path, s->path+sizeof s->path, path);
 	}
-
-	if(p->ascii)
-		strecpy(dst, dst+ndst, "...");
-	else
-		strecpy(dst, dst+ndst, "…");
+	s->ms = ms;
+	s->parse = parse;
+	s->bound = 1;
+	s->due = 0;
+	s->hash = 0;    /* parse on the next poll */
+	return s;
 }
 
-/* ----------------- rio window model ----------------- */
-
-static int
-readfile(char *path, char *buf, int nbuf)
+/* before initmods: every source is unbound until a module binds it again */
+static void
+srcunbind(Panel *p)
 {
-	int fd, n;
-	fd = open(path, OREAD);
-	if(fd < 0)
-		return -1;
-	n = read(fd, buf, nbuf-1);
-	close(fd);
-	if(n < 0)
-		return -1;
-	buf[n] = 0;
-	return n;
+	int i;
+
+	for(i=0; i<p->nsrc; i++)
+		p->src[i].bound = 0;
 }
 
-/* wctl: "minx miny maxx maxy pid current" (format can vary; we only need coords + current) */
-static int
-parsewctl(char *s, int *minx, int *miny, int *maxx, int *maxy, int *iscurrent)
+static void
+srcsweep(Panel *p)
 {
-	char *f[16];
-	int nf;
-
-	nf = getfields(s, f, 16, 1, " \t\r\n");
-	if(nf < 6)
-		return 0;
+	int i;
 
-	*minx = atoi(f[0]);
-	*miny = atoi(f[1]);
-	*maxx = atoi(f[2]);
-	*maxy = atoi(f[3]);
-	*iscurrent = (strcmp(f[5], "current") == 0);
-	return 1;
+	for(i=p->nsrc-1; i>=0; i--){
+		if(p->src[i].bound)
+			continue;
+		if(p->src[i].fd >= 0)
+			close(p->src[i].fd);
+		p->src[i] = p->src[--p->nsrc];
+	}
 }
 
 static void
-updatewins(Panel *p)
+srcpoll(Panel *p, Psrc *s)
 {
-	int fd, nd, i, n, curid;
-	Dir *d;
-	char path[256], buf[512];
-	int minx, miny, maxx, maxy, iscur;
-
-	p->nwins = 0;
-	curid = -1;
-
-	fd = open("/dev/wsys", OREAD);
-	if(fd < 0)
-		return;
-
-	nd = dirreadall(fd, &d);
-	close(fd);
-	if(nd <= 0 || d == nil)
-		return;
-
-	for(i=0; i<nd && p->nwins < MaxWins; i++){
-		if(d[i].qid.type & QTDIR){
-			int id = atoi(d[i].name);
-			if(id <= 0)
-				continue;
-
-			snprint(path, sizeof path, "/dev/wsys/%d/wctl", id);
-			n = readfile(path, buf, sizeof buf);
-			if(n < 0)
-				continue;
-			if(!parsewctl(buf, &minx, &miny, &maxx, &maxy, &iscur))
-				continue;
-
-			snprint(path, sizeof path, "/dev/wsys/%d/label", id);
-			if(readfile(path, buf, sizeof buf) < 0)
-				strecpy(buf, buf+sizeof buf, "window");
-			chomp(buf);
-
-			p->wins[p->nwins].id = id;
-			p->wins[p->nwins].current = iscur;
-			strecpy(p->wins[p->nwins].label, p->wins[p->nwins].label+sizeof p->wins[p->nwins].label, buf);
-
-			if(iscur)
-				curid = id;
+	char buf[2048];
+	uvlong h;
+	vlong t0;
+	int n;
 
-			p->nwins++;
+	t0 = nsec();
+	s->polls++;
+	n = -1;
+	if(s->fd < 0){
+		s->fd = open(s->path, OREAD);
+		s->opens++;
+	}
+	if(s->fd >= 0){
+		n = pread(s->fd, buf, sizeof buf-1, 0);
+		s->reads++;
+		if(n < 0){
+			/* gone (interface unplugged): reopen next time */
+			close(s->fd);
+			s->fd = -1;
 		}
 	}
+	if(n < 0){
+		n = -1;
+		h = 1;
+	}else{
+		buf[n] = 0;
+		h = srchash(buf, n);
+	}
+	if(h != s->hash){
+		s->hash = h;
+		s->parses++;
+		s->parse(p, s, buf, n);
+		if(p->stats)
+			fprint(2, "9de-panel: src %s polls %lud opens %lud parses %lud avg %lldµs\n",
+				s->name, s->polls, s->opens, s->parses, (s->ns + nsec() - t0) / s->polls / 1000);
+	}
+	s->ns += nsec() - t0;
+}
 
-	free(d);
+static void pollext(Panel*);
 
-	if(curid >= 0){
-		for(i=0; i<p->nwins; i++){
-			if(p->wins[i].id == curid){
-				Font *f = p->ui.font ? p->ui.font : font;
-				ellipsize(p, p->ws_label, sizeof p->ws_label, p->wins[i].label, p->ws_maxw - 40, f);
-				return;
-			}
-		}
-	}
+static void
+ticksrc(void *arg)
+{
+	Panel *p = arg;
+	vlong now;
+	int i;
 
-	if(p->ws_label[0] == 0)
-		strecpy(p->ws_label, p->ws_label+sizeof p->ws_label, "ws");
+	now = ui9nowms();
+	for(i=0; i<p->nsrc; i++)
+		if(now >= p->src[i].due){
+			p->src[i].due = now + p->src[i].ms;
+			srcpoll(p, &p->src[i]);
+		}
+	pollext(p);
 }
 
+/* the net label lists every bound interface that has an address */
 static void
-focuswin(int id)
+fmtnet(Panel *p)
 {
-	char path[128];
-	int fd;
+	char buf[MaxStr], *b, *e;
+	int i;
 
-	snprint(path, sizeof path, "/dev/wsys/%d/wctl", id);
-	fd = open(path, OWRITE);
-	if(fd < 0)
-		return;
-	write(fd, "current", 7);
-	close(fd);
+	b = buf;
+	e = buf + sizeof buf;
+	*b = 0;
+	for(i=0; i<p->nsrc; i++)
+		if(strncmp(p->src[i].name, "ipifc", 5) == 0 && p->src[i].val[0] != 0)
+			b = seprint(b, e, "%s%s", b > buf ? " " : "", p->src[i].val);
+	setlabel(p, p->net_label, sizeof p->net_label, buf[0] ? buf : "net");
 }
 
+/* /net/ipifc/N/status: first "ip=" address, empty if none or absent */
 static void
-setpanelheight(Panel *p, int newh)
+parseipifc(Panel *p, Psrc *s, char *buf, int n)
 {
-	int fd, n;
-	char buf[256];
-	int minx, miny, maxx, maxy, iscur;
-	char cmd[128];
-
-	fd = open("/dev/wctl", ORDWR);
-	if(fd < 0)
-		return;
+	char *a, *q;
 
-	n = read(fd, buf, sizeof buf-1);
+	s->val[0] = 0;
+	if(n > 0 && (a = strstr(buf, "ip=")) != nil){
+		a += 3;
+		for(q=a; *q && *q!=' ' && *q!='\n' && q-a < (int)sizeof s->val-1; q++)
+			;
+		snprint(s->val, sizeof s->val, "%.*s", (int)(q-a), a);
+	}
+	fmtnet(p);
+}
+
+static void
+bindnet(Panel *p)
+{
+	char *f[MaxSrc], buf[MaxStr], name[16], path[64];
+	int i, n;
+
+	strecpy(buf, buf+sizeof buf, p->panel_netifc);
+	n = getfields(buf, f, nelem(f), 1, " \t");
+	for(i=0; i<n; i++){
+		snprint(name, sizeof name, "ipifc%s", f[i]);
+		snprint(path, sizeof path, "/net/ipifc/%s/status", f[i]);
+		srcbind(p, name, path, 1000, parseipifc);
+	}
+	fmtnet(p);
+}
+
+/* ----------------- external modules ----------------- */
+
+/*
+ * panel_ext="name:refreshms:timeoutms[:path] ..." adds modules that run
+ * outside the panel. path defaults to $home/lib/9de/mod/<name>; an
+ * executable is run every refresh and its stdout read, anything else
+ * is opened and read as a file (a 9P server's status file, say).
+ * Output lines:
+ *   label <text>
+ *   state ok|warn|err
+ * a bare first line is taken as the label.
+ *
+ * Each module gets a helper proc that does the I/O under an alarm. A
+ * run that blows the budget keeps the last good value and flags the
+ * module; the helper only ever writes its Pext under lk, and the UI
+ * proc copies results out from ticksrc.
+ */
+
+enum { ExtOk, ExtWarn, ExtErr };
+
+static int  mod_ext_measure(Panel*, Pmod*);
+static void mod_ext_draw(Panel*, Pmod*, Image*, Rectangle, int, int);
+
+static int
+extnote(void *a, char *msg)
+{
+	USED(a);
+	return strcmp(msg, "alarm") == 0;
+}
+
+/* one run: 1 and the output in buf if it finished within the budget */
+static int
+extrun(Pext *e, char *buf, int nbuf, int *late)
+{
+	int fd, pfd[2], n, m, pid;
+
+	*late = 0;
+	pid = 0;
+	if(access(e->path, AEXEC) == 0){
+		if(pipe(pfd) < 0)
+			return 0;
+		pid = rfork(RFPROC|RFFDG|RFNOWAIT);
+		if(pid < 0){
+			close(pfd[0]);
+			close(pfd[1]);
+			return 0;
+		}
+		if(pid == 0){
+			dup(pfd[1], 1);
+			close(pfd[0]);
+			close(pfd[1]);
+			execl(e->path, e->name, nil);
+			exits("exec");
+		}
+		close(pfd[1]);
+		fd = pfd[0];
+		alarm(e->timeout);
+	}else{
+		alarm(e->timeout);
+		fd = open(e->path, OREAD);
+		if(fd < 0){
+			*late = alarm(0) == 0;   /* an open that hung until the alarm */
+			return 0;
+		}
+	}
+
+	n = m = 0;
+	while(n < nbuf-1 && (m = read(fd, buf+n, nbuf-1-n)) > 0){
+		n += m;
+		if(pid == 0)
+			break;      /* files: one read */
+	}
+	*late = alarm(0) == 0 && m < 0;
+	close(fd);
+	if(*late && pid > 0)
+		postnote(PNPROC, pid, "kill");
+	buf[n] = 0;
+	return !*late && n > 0;
+}
+
+static void
+extparse(char *buf, char *label, int nlabel, int *state)
+{
+	char *ln, *next;
+
+	for(ln=buf; ln != nil && *ln; ln=next){
+		if((next = strchr(ln, '\n')) != nil)
+			*next++ = 0;
+		if(strncmp(ln, "label ", 6) == 0)
+			strecpy(label, label+nlabel, ln+6);
+		else if(strncmp(ln, "state ", 6) == 0)
+			*state = strcmp(ln+6, "err") == 0 ? ExtErr : strcmp(ln+6, "warn") == 0 ? ExtWarn : ExtOk;
+		else if(ln == buf)
+			strecpy(label, label+nlabel, ln);
+	}
+}
+
+static void
+exthelper(Pext *e)
+{
+	char buf[1024], label[MaxStr];
+	int ok, state, late;
+	vlong t0, dt;
+
+	late = 0;
+	while(!e->quit){
+		t0 = nsec();
+		label[0] = 0;
+		state = ExtOk;
+		ok = extrun(e, buf, sizeof buf, &late);
+		if(ok)
+			extparse(buf, label, sizeof label, &state);
+		dt = nsec() - t0;
+
+		lock(&e->lk);
+		if(ok && label[0] != 0){
+			strecpy(e->got, e->got+sizeof e->got, label);
+			e->gotstate = state;
+		}
+		e->late = late;
+		e->lastns = dt;
+		e->runs++;
+		if(late)
+			e->lates++;
+		e->seq++;
+		unlock(&e->lk);
+
+		dt /= 1000000;
+		if(dt < e->ms)
+			sleep(e->ms - dt);
+	}
+	free(e);
+	exits(nil);
+}
+
+/* start helpers for panel_ext; a changed list replaces them all */
+static void
+startext(Panel *p)
+{
+	char buf[256], *f[MaxExt], *a[4];
+	Pext *e;
+	int i, n, na, pid;
+
+	if(strcmp(p->ext_running, p->panel_ext) == 0)
+		return;
+	for(i=0; i<p->next; i++)
+		p->ext[i]->quit = 1;     /* the helper frees it on its next wakeup */
+	p->next = 0;
+	strecpy(p->ext_running, p->ext_running+sizeof p->ext_running, p->panel_ext);
+
+	strecpy(buf, buf+sizeof buf, p->panel_ext);
+	n = getfields(buf, f, nelem(f), 1, " \t");
+	for(i=0; i<n; i++){
+		na = getfields(f[i], a, nelem(a), 0, ":");
+		if(na < 3 || a[0][0] == 0)
+			continue;
+		e = mallocz(sizeof *e, 1);
+		if(e == nil)
+			break;
+		strecpy(e->name, e->name+sizeof e->name, a[0]);
+		e->ms = atoi(a[1]);
+		e->timeout = atoi(a[2]);
+		if(e->ms < TickMs) e->ms = TickMs;
+		if(e->timeout <= 0 || e->timeout > e->ms) e->timeout = e->ms;
+		if(na == 4)
+			strecpy(e->path, e->path+sizeof e->path, a[3]);
+		else
+			snprint(e->path, sizeof e->path, "%s/lib/9de/mod/%s", home(), e->name);
+		strecpy(e->label, e->label+sizeof e->label, e->name);
+		e->mod = (Pmod){ e->name, 1, 0, 0, nil, mod_ext_measure, mod_ext_draw, nil };
+		e->mod.ext = e;
+
+		pid = rfork(RFPROC|RFMEM|RFNOWAIT);
+		if(pid < 0){
+			free(e);
+			continue;
+		}
+		if(pid == 0)
+			exthelper(e);
+		p->ext[p->next++] = e;
+	}
+}
+
+static int
+findext(Panel *p, char *name, Pmod **out)
+{
+	int i;
+
+	for(i=0; i<p->next; i++)
+		if(strcmp(p->ext[i]->name, name) == 0){
+			*out = &p->ext[i]->mod;
+			return 1;
+		}
+	return 0;
+}
+
+/* UI proc: take whatever the helpers finished since the last tick */
+static void
+pollext(Panel *p)
+{
+	char label[MaxStr];
+	Pext *e;
+	int i, state, late;
+	ulong runs, lates;
+	vlong ns;
+
+	for(i=0; i<p->next; i++){
+		e = p->ext[i];
+		if(e->seq == e->seen)
+			continue;
+		lock(&e->lk);
+		e->seen = e->seq;
+		strecpy(label, label+sizeof label, e->got[0] ? e->got : e->name);
+		state = e->gotstate;
+		late = e->late;
+		ns = e->lastns;
+		runs = e->runs;
+		lates = e->lates;
+		unlock(&e->lk);
+
+		e->avgns = e->avgns ? (e->avgns*7 + ns) / 8 : ns;
+		if(state != e->state || late != e->flagged){
+			e->state = state;
+			e->flagged = late;
+			e->mod.dirty = 1;
+			p->remeasure = 1;
+			p->dirty = 1;
+		}
+		setlabel(p, e->label, sizeof e->label, label);
+		if(p->stats)
+			fprint(2, "9de-panel: ext %s %lldms avg %lldms budget %ldms late %lud/%lud\n",
+				e->name, ns/1000000, e->avgns/1000000, e->timeout, lates, runs);
+	}
+}
+
+/* text fitting */
+static void
+ellipsize(Panel *p, char *dst, int ndst, char *src, int maxpx, Font *f)
+{
+	char tmp[MaxStr];
+	int n;
+
+	if(src == nil){
+		dst[0] = 0;
+		return;
+	}
+
+	strecpy(tmp, tmp+sizeof tmp, src);
+
+	if(stringwidth(f, tmp) <= maxpx){
+		strecpy(dst, dst+ndst, tmp);
+		return;
+	}
+
+	for(n=strlen(tmp); n>0; n--){
+		tmp[n] = 0;
+		if(p->ascii)
+			snprint(dst, ndst, "%s...", tmp);
+		else
+			snprint(dst, ndst, "%s…", tmp);
+		if(stringwidth(f, dst) <= maxpx)
+			return;
+	}
+
+	if(p->ascii)
+		strecpy(dst, dst+ndst, "...");
+	else
+		strecpy(dst, dst+ndst, "…");
+}
+
+/* ----------------- rio window model ----------------- */
+
+/* wctl: "minx miny maxx maxy pid current" (format can vary; we only need coords + current) */
+static int
+parsewctl(char *s, int *minx, int *miny, int *maxx, int *maxy, int *iscurrent)
+{
+	char *f[16];
+	int nf;
+
+	nf = getfields(s, f, 16, 1, " \t\r\n");
+	if(nf < 6)
+		return 0;
+
+	*minx = atoi(f[0]);
+	*miny = atoi(f[1]);
+	*maxx = atoi(f[2]);
+	*maxy = atoi(f[3]);
+	*iscurrent = (strcmp(f[5], "current") == 0);
+	return 1;
+}
+
+/* copy the model into the minibar's list */
+static void
+growwins(Panel *p, int n)
+{
+	if(n <= p->awins)
+		return;
+	p->awins = p->awins ? p->awins*2 : 32;
+	if(p->awins < n)
+		p->awins = n;
+	p->wins = realloc(p->wins, p->awins * sizeof p->wins[0]);
+	if(p->wins == nil)
+		sysfatal("wins: %r");
+}
+
+static void
+syncwins(Panel *p)
+{
+	Ui9Win *w;
+	int i;
+
+	growwins(p, p->wsys->nwin);
+	for(i=0; i<p->wsys->nwin; i++){
+		w = &p->wsys->win[i];
+		p->wins[i].id = w->id;
+		p->wins[i].current = w->current;
+		strecpy(p->wins[i].label, p->wins[i].label+sizeof p->wins[i].label, w->label);
+	}
+	p->nwins = p->wsys->nwin;
+	p->winslaid = 0;
+}
+
+static void
+setwslabel(Panel *p)
+{
+	Ui9Win *w;
+	Font *f;
+	char buf[MaxStr];
+
+	w = ui9wsys_find(p->wsys, p->wsys->focus);
+	if(w == nil){
+		setlabel(p, p->ws_label, sizeof p->ws_label, "ws");   /* nothing current */
+		return;
+	}
+	f = p->ui.font ? p->ui.font : font;
+	ellipsize(p, buf, sizeof buf, w->label, p->ws_maxw - 40, f);
+	setlabel(p, p->ws_label, sizeof p->ws_label, buf);
+}
+
+/* apply /dev/wsys deltas; marks the panel dirty only if the list changed */
+static int
+updatewins(Panel *p)
+{
+	Ui9WinDelta *d;
+	int i, n;
+
+	if(p->wsys == nil)
+		p->wsys = ui9wsys_open(nil);
+	if(p->bench)    /* windows come from the trace */
+		return 0;
+	n = ui9wsys_update(p->wsys);
+	if(n <= 0){
+		if(p->ws_label[0] == 0)
+			setlabel(p, p->ws_label, sizeof p->ws_label, "ws");
+		return 0;
+	}
+	for(i=0; i<n; i++){
+		d = &p->wsys->d[i];
+		if(d->op == Ui9WinFocus || (d->op == Ui9WinTitle && d->id == p->wsys->focus))
+			setwslabel(p);
+	}
+	syncwins(p);
+	p->minidirty = 1;
+	p->dirty = 1;
+	return 1;
+}
+
+/* "id current|- label" per line, at most max lines (-b traces embed them) */
+static void
+parsewins(Panel *p, Biobuf *b, int max)
+{
+	char *ln, *s, buf[MaxStr];
+	int id, cur, n, i, anycur;
+	Font *f;
+
+	n = anycur = 0;
+	for(i=0; i<max && (ln = Brdline(b, '\n')) != nil; i++){
+		ln[Blinelen(b)-1] = 0;
+		id = strtol(ln, &s, 10);
+		if(id <= 0 || *s++ != ' ')
+			continue;
+		cur = strncmp(s, "current ", 8) == 0;
+		if((s = strchr(s, ' ')) == nil)
+			continue;
+		growwins(p, n+1);
+		p->wins[n].id = id;
+		p->wins[n].current = cur;
+		strecpy(p->wins[n].label, p->wins[n].label+sizeof p->wins[n].label, s+1);
+		if(cur){
+			anycur = 1;
+			f = p->ui.font ? p->ui.font : font;
+			ellipsize(p, buf, sizeof buf, s+1, p->ws_maxw - 40, f);
+			setlabel(p, p->ws_label, sizeof p->ws_label, buf);
+		}
+		n++;
+	}
+	if(!anycur)
+		setlabel(p, p->ws_label, sizeof p->ws_label, "ws");
+	p->nwins = n;
+	p->winslaid = 0;
+	p->minidirty = 1;
+	p->dirty = 1;
+}
+
+/* /mnt/9de/windows (9de-shell's watcher) */
+static void
+readsrvwins(Panel *p)
+{
+	Biobuf *b;
+
+	b = Bopen("/mnt/9de/windows", OREAD);
+	if(b == nil)
+		return;
+	parsewins(p, b, 1<<30);
+	Bterm(b);
+}
+
+static void
+focuswin(int id)
+{
+	char path[128];
+	int fd;
+
+	snprint(path, sizeof path, "/dev/wsys/%d/wctl", id);
+	fd = open(path, OWRITE);
+	if(fd < 0)
+		return;
+	write(fd, "current", 7);
+	close(fd);
+}
+
+/* -b: a new offscreen target stands in for the window resize */
+static void
+benchresize(Panel *p, int h)
+{
+	Image *i;
+
+	if(p->dst != nil && Dy(p->dst->r) == h)
+		return;
+	i = allocimage(display, Rect(0, 0, BenchW, h), screen->chan, 0, DNofill);
+	if(i == nil)
+		sysfatal("allocimage: %r");
+	nimg++;
+	if(p->dst != nil && p->dst != screen)
+		freeimage(p->dst);
+	p->dst = i;
+	ui9setdst(&p->ui, p->dst);
+	p->rzn++;
+	p->dirty = 1;
+	p->full = 1;     /* a fresh target has none of the old pixels */
+}
+
+static void
+setpanelheight(Panel *p, int newh)
+{
+	int fd, n;
+	char buf[256];
+	int minx, miny, maxx, maxy, iscur;
+	char cmd[128];
+
+	if(p->bench){
+		benchresize(p, newh);
+		return;
+	}
+
+	fd = open("/dev/wctl", ORDWR);
+	if(fd < 0)
+		return;
+
+	n = read(fd, buf, sizeof buf-1);
 	if(n <= 0){
 		close(fd);
 		return;
 	}
 	buf[n] = 0;
 
-	if(!parsewctl(buf, &minx, &miny, &maxx, &maxy, &iscur)){
+	if(!parsewctl(buf, &minx, &miny, &maxx, &maxy, &iscur) || maxy - miny == newh){
 		close(fd);
 		return;
 	}
 
+	p->rzn++;
 	snprint(cmd, sizeof cmd, "resize -r %d %d %d %d", minx, miny, maxx, miny + newh);
 	seek(fd, 0, 0);
 	write(fd, cmd, strlen(cmd));
@@ -952,97 +1508,284 @@ markdirty(void *arg)
 {
 	Panel *p = arg;
 	p->dirty = 1;
+	p->full = 1;
+}
+
+/*
+ * The watcher is a plain proc that shares nothing with the panel but
+ * the namespace: it (re)mounts /srv/9de, reads status and the event
+ * stream, and writes one message per line down a pipe that the event
+ * loop reads through estart, so Panel is only touched by the UI proc.
+ *
+ *   up <reconnects> <windows>\n<status>   connected; status snapshot follows
+ *   sync <reconnects> <windows>\n<status> events were lost ("lost N"); same resync,
+ *                                         status empty if state/preset did not move
+ *   ev <ms> <line>                        an event, ms when the watcher read it
+ *   down                                  the stream ended
+ *
+ * A lost connection is retried with exponential backoff, so a 9de-shell
+ * restart is picked up within WatchMaxMs.
+ */
+static void
+watchsend(int fd, char *fmt, ...)
+{
+	char buf[WatchMsg];
+	va_list arg;
+	int n;
+
+	va_start(arg, fmt);
+	n = vsnprint(buf, sizeof buf, fmt, arg);
+	va_end(arg);
+	if(write(fd, buf, n) != n)
+		exits(nil);     /* the panel is gone */
 }
 
+static int
+watchconnect(void)
+{
+	int fd;
+
+	fd = open("/srv/9de", ORDWR);
+	if(fd < 0)
+		return -1;
+	mkdir("/mnt/9de");
+	/* MREPL: a mount left over from a previous shell is hung up */
+	if(mount(fd, -1, "/mnt/9de", MREPL, "") < 0){
+		close(fd);
+		return -1;
+	}
+	return open("/mnt/9de/events", OREAD);
+}
+
+/*
+ * the preset, as a status line: from state/preset when the shell has
+ * one, reread only if its qid.vers moved (or fresh, after a connect);
+ * empty when unchanged. Older shells only have status.
+ */
 static void
-apply_status_snapshot(Panel *p)
+watchstatus(char *buf, int nbuf, ulong *vers, int fresh)
 {
+	char val[64];
+	Dir *d;
 	int fd, n;
-	char buf[256];
 
+	buf[0] = 0;
+	if((d = dirstat("/mnt/9de/state/preset")) != nil){
+		if(!fresh && d->qid.vers == *vers){
+			free(d);
+			return;
+		}
+		*vers = d->qid.vers;
+		free(d);
+		fd = open("/mnt/9de/state/preset", OREAD);
+		if(fd < 0)
+			return;
+		n = read(fd, val, sizeof val-1);
+		close(fd);
+		if(n > 0){
+			val[n] = 0;
+			snprint(buf, nbuf, "preset %s", val);
+		}
+		return;
+	}
 	fd = open("/mnt/9de/status", OREAD);
-	if(fd < 0) return;
-	n = read(fd, buf, sizeof buf-1);
+	if(fd < 0)
+		return;
+	n = read(fd, buf, nbuf-1);
 	close(fd);
-	if(n <= 0) return;
-	buf[n] = 0;
+	if(n > 0)
+		buf[n] = 0;
+}
 
-	{
-		char *s = strstr(buf, "preset ");
-		if(s){
-			s += 7;
-			chomp(s);
-			snprint(p->preset_label, sizeof p->preset_label, "style: %s", s);
+static void
+watchproc(int out)
+{
+	char buf[WatchMsg], st[256], *s, *e;
+	int fd, n, backoff, ups;
+	ulong vers;
+	vlong t;
+
+	backoff = WatchMinMs;
+	vers = 0;
+	for(ups=0;;){
+		if((fd = watchconnect()) >= 0){
+			watchstatus(st, sizeof st, &vers, 1);
+			watchsend(out, "up %d %d\n%s", ups++, access("/mnt/9de/windows", AEXIST) == 0, st);
+			backoff = WatchMinMs;
+
+			/* the stream has no offsets: every read is at 0 */
+			while((n = pread(fd, buf, sizeof buf-1, 0)) > 0){
+				buf[n] = 0;
+				t = ui9nowms();
+				for(s=buf; *s; s=e){
+					if((e = strchr(s, '\n')) != nil)
+						*e++ = 0;
+					else
+						e = s + strlen(s);
+					if(strncmp(s, "lost ", 5) == 0){
+						watchstatus(st, sizeof st, &vers, 0);
+						watchsend(out, "sync %d %d\n%s", ups-1, access("/mnt/9de/windows", AEXIST) == 0, st);
+					}else if(*s)
+						watchsend(out, "ev %lld %s", t, s);
+				}
+			}
+			close(fd);
+			watchsend(out, "down");
 		}
+		sleep(backoff);
+		backoff *= 2;
+		if(backoff > WatchMaxMs)
+			backoff = WatchMaxMs;
 	}
 }
 
 static void
-srvwatch(Panel *p)
+startsrvwatcher(Panel *p)
 {
-	Biobuf *b;
-	char *ln;
-	int fd;
+	int pfd[2];
 
-	if(access("/srv/9de", AEXIST) != 0){
-		p->de_up = 0;
-		snprint(p->de_label, sizeof p->de_label, "de: down");
+	if(!p->enable_watch || pipe(pfd) < 0)
 		return;
-	}
 
-	mkdir("/mnt/9de");
-	if(access("/mnt/9de/status", AEXIST) != 0)
-		system("mount -c /srv/9de /mnt/9de >[2]/dev/null");
+	switch(rfork(RFPROC|RFFDG|RFNOWAIT)){
+	case -1:
+		close(pfd[0]);
+		close(pfd[1]);
+		return;
+	case 0:
+		close(pfd[0]);
+		watchproc(pfd[1]);
+		exits(nil);
+	}
+	close(pfd[1]);
+	p->watchkey = estart(0, pfd[0], WatchMsg);
+}
 
-	apply_status_snapshot(p);
+/* "preset x\npanel y\n" */
+static void
+srvstatus(Panel *p, char *s)
+{
+	char *e;
 
-	fd = open("/mnt/9de/events", OREAD);
-	if(fd < 0)
+	if((s = strstr(s, "preset ")) == nil)
 		return;
+	s += 7;
+	if((e = strchr(s, '\n')) != nil)
+		*e = 0;
+	snprint(p->preset_label, sizeof p->preset_label, "style: %s", s);
+	marklabels(p);
+}
 
-	b = Bfdopen(fd, OREAD);
-	if(b == nil){
-		close(fd);
-		return;
-	}
+/* ----------------- notifications ----------------- */
 
-	for(;;){
-		ln = Brdline(b, '\n');
-		if(ln == nil)
-			break;
-		ln[Blinelen(b)-1] = 0;
+static void
+fmtnotif(Panel *p)
+{
+	char buf[MaxStr];
 
-		if(strncmp(ln, "ok ", 3) == 0){
-			p->de_up = 1;
-			snprint(p->de_label, sizeof p->de_label, "de: ok");
-			if(strncmp(ln, "ok setpreset ", 13) == 0)
-				snprint(p->preset_label, sizeof p->preset_label, "style: %s", ln+13);
-			if(strcmp(ln, "ok reload") == 0 || strcmp(ln, "ok apply") == 0)
-				p->need_reload = 1;
-			markdirty(p);
-		}else if(strncmp(ln, "err ", 4) == 0){
-			p->de_up = 1;
-			snprint(p->de_label, sizeof p->de_label, "de: err");
-			p->notif_count++;
-			markdirty(p);
-		}
+	if(p->notif_count > 0)
+		snprint(buf, sizeof buf, "%s %d", sym(p, "•", "!"), p->notif_count);
+	else
+		snprint(buf, sizeof buf, "%s", sym(p, "•", "!"));
+	setlabel(p, p->notif_label, sizeof p->notif_label, buf);
+}
+
+/* O(1): bump the newest entry if s repeats it, else take the next ring slot */
+static void
+notepush(Panel *p, char *s)
+{
+	Pnote *e;
+	long now;
+
+	now = p->bench ? p->benchms/1000 : time(0);
+	e = p->notehead > 0 ? &p->notes[(p->notehead-1) % MaxNotes] : nil;
+	if(e != nil && strcmp(e->text, s) == 0){
+		e->n++;
+		e->last = now;
+		p->coalesced++;
+	}else{
+		e = &p->notes[p->notehead++ % MaxNotes];
+		strecpy(e->text, e->text+sizeof e->text, s);
+		e->n = 1;
+		e->first = e->last = now;
+		if(p->notescroll > 0)
+			p->notescroll++;     /* keep the rows being read in place */
 	}
+	if(p->notesopen){
+		p->minidirty = 1;
+		p->dirty = 1;
+	}else
+		p->notif_count++;
+	fmtnotif(p);
+}
 
-	Bterm(b);
+static void
+srvevent(Panel *p, char *ln)
+{
+	if(strncmp(ln, "win ", 4) == 0){
+		p->winsync = 1;
+		return;
+	}
+	if(strncmp(ln, "ok ", 3) == 0){
+		p->de_up = 1;
+		snprint(p->de_label, sizeof p->de_label, "de: ok");
+		if(strncmp(ln, "ok setpreset ", 13) == 0)
+			snprint(p->preset_label, sizeof p->preset_label, "style: %s", ln+13);
+		if(strcmp(ln, "ok reload") == 0 || strcmp(ln, "ok apply") == 0)
+			p->need_reload = 1;
+		marklabels(p);
+	}else if(strncmp(ln, "err ", 4) == 0){
+		/* storms: O(1) each, and only the labels that change repaint */
+		p->de_up = 1;
+		setlabel(p, p->de_label, sizeof p->de_label, "de: err");
+		notepush(p, ln);
+	}
 }
 
+/* one watcher message, from the event loop */
 static void
-startsrvwatcher(Panel *p)
+srvmsg(Panel *p, char *data, int n)
 {
-	int pid;
+	char buf[WatchMsg+1], *s;
+	vlong lag;
 
-	if(!p->enable_watch)
-		return;
+	if(n > WatchMsg)
+		n = WatchMsg;
+	memmove(buf, data, n);
+	buf[n] = 0;
 
-	pid = rfork(RFPROC|RFMEM|RFNOWAIT);
-	if(pid == 0){
-		srvwatch(p);
-		exits(nil);
+	if(strncmp(buf, "ev ", 3) == 0){
+		lag = ui9nowms() - strtoll(buf+3, &s, 10);
+		if(*s++ != ' ')
+			return;
+		p->srvevents++;
+		p->srvlag += lag;
+		if(lag > p->srvlagmax)
+			p->srvlagmax = lag;
+		srvevent(p, s);
+	}else if(strncmp(buf, "up ", 3) == 0 || strncmp(buf, "sync ", 5) == 0){
+		if(buf[0] == 's')
+			p->srvlost++;
+		p->srvups = strtol(strchr(buf, ' ')+1, &s, 10);
+		p->de_up = 1;
+		snprint(p->de_label, sizeof p->de_label, "de: ok");
+		/* a shell that publishes windows replaces our own /dev/wsys polling */
+		if(atoi(s) != 0){
+			p->winsrv = 1;
+			p->winsync = 1;
+		}
+		if((s = strchr(s, '\n')) != nil)
+			srvstatus(p, s+1);
+		marklabels(p);
+		if(p->stats)
+			fprint(2, "9de-panel: srv %s, reconnects %d resyncs %d events %lud lag avg %lldms max %lldms\n",
+				buf[0] == 's' ? "sync" : "up", p->srvups, p->srvlost,
+				p->srvevents, p->srvevents ? p->srvlag/p->srvevents : 0, p->srvlagmax);
+	}else if(strcmp(buf, "down") == 0){
+		p->winsrv = 0;
+		p->de_up = 0;
+		snprint(p->de_label, sizeof p->de_label, "de: down");
+		marklabels(p);
 	}
 }
 
@@ -1055,9 +1798,13 @@ panelstring(Panel *p, Point pt, char *s)
 	Image *shadow = ui9img(&p->ui, Ui9CShadow);
 	Image *text = ui9img(&p->ui, Ui9CTopbarText);
 
-	/* shadow alpha can be 0; still safe */
-	string(p->ui.dst, addpt(pt, Pt(0,1)), shadow, ZP, f, s);
+	/* shadow alpha is 0 in the terminal preset: skip the pass */
+	if(ui9visible(&p->ui, Ui9CShadow)){
+		string(p->ui.dst, addpt(pt, Pt(0,1)), shadow, ZP, f, s);
+		p->ui.nops++;
+	}
 	string(p->ui.dst, pt, text, ZP, f, s);
+	p->ui.nops++;
 }
 
 static void
@@ -1066,8 +1813,13 @@ ministring(Panel *p, Point pt, char *s, int muted)
 	Font *f = p->ui.font ? p->ui.font : font;
 	Image *shadow = ui9img(&p->ui, Ui9CShadow);
 	Image *text = ui9img(&p->ui, muted ? Ui9CMuted : Ui9CText);
-	string(p->ui.dst, addpt(pt, Pt(0,1)), shadow, ZP, f, s);
+
+	if(ui9visible(&p->ui, Ui9CShadow)){
+		string(p->ui.dst, addpt(pt, Pt(0,1)), shadow, ZP, f, s);
+		p->ui.nops++;
+	}
 	string(p->ui.dst, pt, text, ZP, f, s);
+	p->ui.nops++;
 }
 
 /* ----------------- modules ----------------- */
@@ -1095,11 +1847,13 @@ static int  mod_notif_hit(Panel*, Pmod*, Mouse*, Rectangle);
 static char*
 modlabel(Panel *p, Pmod *m)
 {
+	if(m->ext != nil)                  return m->ext->label;
 	if(strcmp(m->name, "ws") == 0)     return p->ws_label;
 	if(strcmp(m->name, "de") == 0)     return p->de_label;
 	if(strcmp(m->name, "net") == 0)    return p->net_label;
 	if(strcmp(m->name, "clock") == 0)  return p->clock_label;
 	if(strcmp(m->name, "preset") == 0) return p->preset_label;
+	if(strcmp(m->name, "notif") == 0)  return p->notif_label;
 	return "";
 }
 
@@ -1114,12 +1868,12 @@ static Pmod allmods[] = {
 };
 
 static void mod_menu_init(Panel *p, Pmod *m){ USED(p); USED(m); }
-static void mod_ws_init(Panel *p, Pmod *m){ USED(m); updatewins(p); }
+static void mod_ws_init(Panel *p, Pmod *m){ USED(m); updatewins(p); setwslabel(p); }
 static void mod_de_init(Panel *p, Pmod *m){ USED(m); fmtde(p); }
-static void mod_net_init(Panel *p, Pmod *m){ USED(m); fmtnet(p); }
+static void mod_net_init(Panel *p, Pmod *m){ USED(m); bindnet(p); }
 static void mod_clock_init(Panel *p, Pmod *m){ USED(m); fmtclock(p); }
 static void mod_preset_init(Panel *p, Pmod *m){ USED(m); fmtpreset(p); }
-static void mod_notif_init(Panel *p, Pmod *m){ USED(p); USED(m); }
+static void mod_notif_init(Panel *p, Pmod *m){ USED(m); fmtnotif(p); }
 
 static int
 mod_menu_measure(Panel *p, Pmod *m)
@@ -1150,17 +1904,8 @@ static int
 mod_text_measure(Panel *p, Pmod *m)
 {
 	Font *f = p->ui.font ? p->ui.font : font;
-	char tmp[MaxStr];
 	char *s = modlabel(p, m);
 
-	if(strcmp(m->name, "notif") == 0){
-		if(p->notif_count > 0)
-			snprint(tmp, sizeof tmp, "%s %d", sym(p, "•", "!"), p->notif_count);
-		else
-			snprint(tmp, sizeof tmp, "%s", sym(p, "•", "!"));
-		s = tmp;
-	}
-
 	m->w = stringwidth(f, s) + p->pad*2;
 	return m->w;
 }
@@ -1178,10 +1923,10 @@ draw_chip(Panel *p, Rectangle r, int hover, int pressed, int focus)
 		else
 			ui9_card(&p->ui, r, rad);
 
-		if(hover)
-			border(p->ui.dst, r, 1, ui9img(&p->ui, Ui9CAccent), ZP);
-		else if(focus)
+		if(hover || focus){
 			border(p->ui.dst, r, 1, ui9img(&p->ui, Ui9CAccent), ZP);
+			p->ui.nops++;
+		}
 	}
 }
 
@@ -1227,27 +1972,59 @@ mod_text_draw(Panel *p, Pmod *m, Image *dst, Rectangle r, int hover, int pressed
 
 	USED(dst); USED(hover); USED(pressed);
 
-	s = modlabel(p, m);
-	pt = Pt(r.min.x + p->pad, r.min.y + (Dy(r)-f->height)/2);
-	panelstring(p, pt, s);
+	s = modlabel(p, m);
+	pt = Pt(r.min.x + p->pad, r.min.y + (Dy(r)-f->height)/2);
+	panelstring(p, pt, s);
+}
+
+static void
+mod_notif_draw(Panel *p, Pmod *m, Image *dst, Rectangle r, int hover, int pressed)
+{
+	Font *f = p->ui.font ? p->ui.font : font;
+	Point pt;
+
+	USED(dst); USED(m);
+
+	if(p->notif_count > 0 || p->notesopen)
+		draw_chip(p, r, hover, pressed, p->notesopen);
+	pt = Pt(r.min.x + p->pad, r.min.y + (Dy(r)-f->height)/2);
+	panelstring(p, pt, p->notif_label);
+}
+
+/* label, plus a marker while the last run was over budget */
+static void
+extshown(Panel *p, Pext *e, char *buf, int nbuf)
+{
+	if(e->flagged)
+		snprint(buf, nbuf, "%s %s", e->label, sym(p, "⌛", "?"));
+	else
+		strecpy(buf, buf+nbuf, e->label);
+}
+
+static int
+mod_ext_measure(Panel *p, Pmod *m)
+{
+	Font *f = p->ui.font ? p->ui.font : font;
+	char buf[MaxStr];
+
+	extshown(p, m->ext, buf, sizeof buf);
+	m->w = stringwidth(f, buf) + p->pad*2;
+	return m->w;
 }
 
 static void
-mod_notif_draw(Panel *p, Pmod *m, Image *dst, Rectangle r, int hover, int pressed)
+mod_ext_draw(Panel *p, Pmod *m, Image *dst, Rectangle r, int hover, int pressed)
 {
 	Font *f = p->ui.font ? p->ui.font : font;
 	char buf[MaxStr];
 	Point pt;
 
-	USED(dst); USED(m);
-
-	if(p->notif_count > 0){
-		draw_chip(p, r, hover, pressed, 0);
-		snprint(buf, sizeof buf, "%s %d", sym(p, "•", "!"), p->notif_count);
-	}else{
-		snprint(buf, sizeof buf, "%s", sym(p, "•", "!"));
-	}
+	USED(dst);
 
+	/* warn/err states keep the chip up */
+	if(m->ext->state != ExtOk)
+		draw_chip(p, r, hover, pressed, 1);
+	extshown(p, m->ext, buf, sizeof buf);
 	pt = Pt(r.min.x + p->pad, r.min.y + (Dy(r)-f->height)/2);
 	panelstring(p, pt, buf);
 }
@@ -1268,12 +2045,12 @@ static int
 mod_notif_hit(Panel *p, Pmod *m, Mouse *ms, Rectangle r)
 {
 	USED(m);
-	if(p->notif_count <= 0)
-		return 0;
 	if((ms->buttons & 1) && ptinrect(ms->xy, r)){
-		ensurelogdir();
-		spawnrc("window 120,120,900,700 rc -c 'echo --- 9de errors ---; ls -l $home/lib/9de/log; echo; tail -n +1 $home/lib/9de/log/*.err'");
+		/* the list is drawn below the bar ('l' still opens the log files) */
+		p->notesopen = !p->notesopen;
+		p->notescroll = 0;
 		p->notif_count = 0;
+		fmtnotif(p);
 		return 1;
 	}
 	return 0;
@@ -1281,15 +2058,124 @@ mod_notif_hit(Panel *p, Pmod *m, Mouse *ms, Rectangle r)
 
 /* ----------------- mini list (hover) ----------------- */
 
+/*
+ * The minibar is a horizontal strip of window chips scrolled by
+ * winscroll. Chip texts, widths and offsets are computed once per list
+ * (or font) change by winlayout; a frame binary-searches the first
+ * visible chip and draws and registers hits only for the chips that
+ * show, so its cost does not grow with the window count.
+ */
+static void
+winreveal(Panel *p, int i)
+{
+	WinEnt *e;
+
+	e = &p->wins[i];
+	if(e->x < p->winscroll)
+		p->winscroll = e->x;
+	else if(e->x + e->w > p->winscroll + p->stripvis)
+		p->winscroll = e->x + e->w - p->stripvis;
+}
+
+static void
+winclamp(Panel *p)
+{
+	int max;
+
+	max = p->stripw - p->gap - p->stripvis;
+	if(p->winscroll > max)
+		p->winscroll = max;
+	if(p->winscroll < 0)
+		p->winscroll = 0;
+}
+
+static void
+winlayout(Panel *p)
+{
+	Font *f = p->ui.font ? p->ui.font : font;
+	char fit[MaxStr];
+	WinEnt *e;
+	int i, x;
+
+	x = 0;
+	for(i=0; i<p->nwins; i++){
+		e = &p->wins[i];
+		ellipsize(p, fit, sizeof fit, e->label, p->win_maxw - 44, f);
+		snprint(e->chip, sizeof e->chip, "%d %s", e->id, fit);
+		e->w = stringwidth(f, e->chip) + p->pad*2;
+		if(e->w > p->win_maxw) e->w = p->win_maxw;
+		e->x = x;
+		x += e->w + p->gap;
+	}
+	p->stripw = x;
+	p->winslaid = 1;
+	if(p->winsel >= p->nwins)
+		p->winsel = p->nwins-1;
+
+	/* follow focus changes, leave the user's scrolling alone otherwise */
+	for(i=0; i<p->nwins; i++)
+		if(p->wins[i].current){
+			if(p->wins[i].id != p->wincur && p->stripvis > 0)
+				winreveal(p, i);
+			p->wincur = p->wins[i].id;
+			break;
+		}
+}
+
+/* first chip that ends right of the scroll offset */
+static int
+winfirst(Panel *p)
+{
+	int lo, hi, m;
+
+	lo = 0;
+	hi = p->nwins;
+	while(lo < hi){
+		m = (lo+hi)/2;
+		if(p->wins[m].x + p->wins[m].w <= p->winscroll)
+			lo = m+1;
+		else
+			hi = m;
+	}
+	return lo;
+}
+
+/* wheel/keys: move the strip or the selection, then repaint the minibar */
+static void
+winscrollby(Panel *p, int dx)
+{
+	p->winscroll += dx;
+	winclamp(p);
+	p->minidirty = 1;
+	p->dirty = 1;
+}
+
+static void
+winselect(Panel *p, int i)
+{
+	if(p->nwins == 0)
+		return;
+	if(!p->winslaid)
+		winlayout(p);
+	if(i < 0) i = 0;
+	if(i >= p->nwins) i = p->nwins-1;
+	p->winsel = i;
+	winreveal(p, i);
+	winclamp(p);
+	p->minidirty = 1;
+	p->dirty = 1;
+}
+
 static void
 drawminibar(Panel *p, Rectangle r)
 {
 	Font *f = p->ui.font ? p->ui.font : font;
-	int i, x, w;
-	Rectangle rr;
+	Image *dst = p->ui.dst;
+	Rectangle sr, rr, hr, clip;
 	Point pt;
-	char buf[MaxStr], fit[MaxStr];
-	int hover, pressed;
+	WinEnt *e;
+	char buf[MaxStr];
+	int i, x, hover, pressed;
 	int hid = -1;
 
 	/* background */
@@ -1304,47 +2190,64 @@ drawminibar(Panel *p, Rectangle r)
 		if(p->ui_minigrad1[0] && parsehexrgb(p->ui_minigrad1, &o1)) c1 = o1;
 
 		ensurevgrad(p->minigrad, &p->minigrad_n, &p->minigrad_c0, &p->minigrad_c1, &p->minigrad_h, Dy(r), c0, c1);
-		drawvgrad(p->ui.dst, r, p->minigrad, p->minigrad_n);
+		p->ui.nops += drawvgrad(p->ui.dst, r, p->minigrad, p->minigrad_n);
 	}else{
 		draw(p->ui.dst, r, ui9img(&p->ui, Ui9CSurface), nil, ZP);
+		p->ui.nops++;
+	}
+	if(ui9visible(&p->ui, Ui9CBorder)){
+		border(p->ui.dst, r, 1, ui9img(&p->ui, Ui9CBorder), ZP);
+		p->ui.nops++;
 	}
-	border(p->ui.dst, r, 1, ui9img(&p->ui, Ui9CBorder), ZP);
-
-	x = r.min.x + p->gap;
-	for(i=0; i<p->nwins; i++){
-		ellipsize(p, fit, sizeof fit, p->wins[i].label, p->win_maxw - 44, f);
-		snprint(buf, sizeof buf, "%d %s", p->wins[i].id, fit);
-
-		w = stringwidth(f, buf) + p->pad*2;
-		if(w > p->win_maxw) w = p->win_maxw;
 
-		rr = Rect(x, r.min.y+2, x+w, r.max.y-2);
+	/* chips scroll in the strip; the path hint keeps the right end */
+	sr = Rect(r.min.x + p->gap, r.min.y+2, r.max.x - 220, r.max.y-2);
+	p->stripvis = Dx(sr);
+	if(!p->winslaid)
+		winlayout(p);
+	winclamp(p);
+
+	clip = dst->clipr;
+	hr = sr;
+	if(rectclip(&hr, clip))
+		replclipr(dst, dst->repl, hr);
+	for(i=winfirst(p); i<p->nwins; i++){
+		e = &p->wins[i];
+		x = sr.min.x + e->x - p->winscroll;
+		if(x >= sr.max.x)
+			break;
+		rr = Rect(x, sr.min.y, x+e->w, sr.max.y);
+		hr = rr;
+		rectclip(&hr, sr);
+		ui9_hitadd(&p->ui, hr, HitWin | e->id);
 
-		hover = ptinrect(p->mousexy, rr);
+		hover = ptinrect(p->mousexy, hr);
 		pressed = hover && (p->mousebuttons & 1);
 
-		if(p->wins[i].current){
+		if(e->current){
 			ui9_card2(&p->ui, rr, (p->ui.theme.radius>6)?6:p->ui.theme.radius);
-			border(p->ui.dst, rr, 1, ui9img(&p->ui, Ui9CAccent), ZP);
+			border(dst, rr, 1, ui9img(&p->ui, Ui9CAccent), ZP);
+			p->ui.nops++;
 		}else{
-			draw_chip(p, rr, hover, pressed, 0);
+			draw_chip(p, rr, hover, pressed, i == p->winsel);
 		}
 
 		pt = Pt(rr.min.x + p->pad, rr.min.y + (Dy(rr)-f->height)/2);
-		ministring(p, pt, buf, 0);
+		ministring(p, pt, e->chip, 0);
 
 		if(hover)
-			hid = p->wins[i].id;
-
-		x += w + p->gap;
-		if(x > r.max.x - 220)
-			break;
+			hid = e->id;
 	}
+	replclipr(dst, dst->repl, clip);
 
 	p->ws_hover_id = hid;
 
+	if(hid < 0 && p->winsel >= 0)
+		hid = p->wins[p->winsel].id;
 	if(hid >= 0)
 		snprint(buf, sizeof buf, "path: /dev/wsys/%d", hid);
+	else if(p->stripw - p->gap > p->stripvis)
+		snprint(buf, sizeof buf, "path: /dev/wsys (%d)", p->nwins);
 	else
 		snprint(buf, sizeof buf, "path: /dev/wsys");
 
@@ -1353,32 +2256,50 @@ drawminibar(Panel *p, Rectangle r)
 	ministring(p, pt, buf, 1);
 }
 
-static int
-hitminibar(Panel *p, Rectangle r, Mouse *m)
+/*
+ * Notification list: NotesRows rows, newest first, read straight out
+ * of the ring at notescroll; nothing is drawn for the entries out of
+ * view.
+ */
+static void
+drawnotes(Panel *p, Rectangle r)
 {
 	Font *f = p->ui.font ? p->ui.font : font;
-	int i, x, w;
-	Rectangle rr;
 	char buf[MaxStr], fit[MaxStr];
+	Pnote *e;
+	Tm *t;
+	int k, n, y;
+
+	draw(p->ui.dst, r, ui9img(&p->ui, Ui9CSurface), nil, ZP);
+	p->ui.nops++;
+	if(ui9visible(&p->ui, Ui9CBorder)){
+		border(p->ui.dst, r, 1, ui9img(&p->ui, Ui9CBorder), ZP);
+		p->ui.nops++;
+	}
 
-	x = r.min.x + p->gap;
-	for(i=0; i<p->nwins; i++){
-		ellipsize(p, fit, sizeof fit, p->wins[i].label, p->win_maxw - 44, f);
-		snprint(buf, sizeof buf, "%d %s", p->wins[i].id, fit);
-
-		w = stringwidth(f, buf) + p->pad*2;
-		if(w > p->win_maxw) w = p->win_maxw;
+	n = p->notehead < MaxNotes ? p->notehead : MaxNotes;
+	if(p->notescroll > n - NotesRows)
+		p->notescroll = n - NotesRows;
+	if(p->notescroll < 0)
+		p->notescroll = 0;
+	if(n == 0){
+		ministring(p, Pt(r.min.x + p->pad, r.min.y + 4), "no notifications", 1);
+		return;
+	}
 
-		rr = Rect(x, r.min.y+2, x+w, r.max.y-2);
-		if((m->buttons & 1) && ptinrect(m->xy, rr)){
-			focuswin(p->wins[i].id);
-			return 1;
-		}
-		x += w + p->gap;
-		if(x > r.max.x - 220)
-			break;
+	y = r.min.y + 4;
+	for(k=0; k<NotesRows && p->notescroll+k < n; k++){
+		e = &p->notes[(p->notehead-1-p->notescroll-k) % MaxNotes];
+		t = localtime(e->last);
+		if(e->n > 1)
+			snprint(buf, sizeof buf, "%02d:%02d:%02d  %s %s%d", t->hour, t->min, t->sec,
+				e->text, p->ascii ? "x" : "×", e->n);
+		else
+			snprint(buf, sizeof buf, "%02d:%02d:%02d  %s", t->hour, t->min, t->sec, e->text);
+		ellipsize(p, fit, sizeof fit, buf, Dx(r) - 2*p->pad, f);
+		ministring(p, Pt(r.min.x + p->pad, y), fit, 0);
+		y += f->height + 4;
 	}
-	return 0;
 }
 
 /* ----------------- layout/draw ----------------- */
@@ -1430,26 +2351,12 @@ sumw(Panel *p, Pmod **mods, int n)
 	return w;
 }
 
+/* topbar background under r (full height of tr), from the cached gradient */
 static void
-drawpanel(Panel *p, Pmod **leftmods, int nleft, Pmod **rightmods, int nright)
+paintbg(Panel *p, Image *dst, Rectangle tr, Rectangle r)
 {
-	Rectangle wr, tr, mr, rr;
-	Image *dst;
-	int i, x;
-	int hover, pressed;
-
-	wr = p->dst->r;
-	p->r = wr;
-
-	tr = wr;
-	tr.max.y = tr.min.y + p->baseh;
-
-	bufrealloc(p);
-	dst = (p->buf != nil) ? p->buf : p->dst;
-	ui9setdst(&p->ui, dst);
-	p->ui.dst = dst;
-
-	/* TOPBAR background */
+	r.min.y = tr.min.y;
+	r.max.y = tr.max.y;
 	if(p->ui_topgrad){
 		ulong c0, c1;
 		ulong o0, o1;
@@ -1464,112 +2371,334 @@ drawpanel(Panel *p, Pmod **leftmods, int nleft, Pmod **rightmods, int nright)
 		if(p->ui_topgrad1[0] && parsehexrgb(p->ui_topgrad1, &o1)) c1 = o1;
 
 		ensurevgrad(p->topgrad, &p->topgrad_n, &p->topgrad_c0, &p->topgrad_c1, &p->topgrad_h, Dy(tr), c0, c1);
-		drawvgrad(dst, tr, p->topgrad, p->topgrad_n);
+		p->ui.nops += drawvgrad(dst, r, p->topgrad, p->topgrad_n);
 	}else{
-		draw(dst, tr, ui9img(&p->ui, Ui9CTopbarBg), nil, ZP);
+		draw(dst, r, ui9img(&p->ui, Ui9CTopbarBg), nil, ZP);
+		p->ui.nops++;
 	}
-	border(dst, tr, 1, ui9img(&p->ui, Ui9CBorder), ZP);
+}
 
-	/* left stack */
-	x = tr.min.x + p->gap;
-	for(i=0; i<nleft; i++){
-		rr = Rect(x, tr.min.y+2, x + leftmods[i]->w, tr.max.y-2);
-		leftmods[i]->last = rr;
+static void
+adddamage(Panel *p, Rectangle r)
+{
+	if(p->ndmg == MaxDamage)
+		combinerect(&p->dmg[MaxDamage-1], r);
+	else
+		p->dmg[p->ndmg++] = r;
+}
 
-		hover = ptinrect(p->mousexy, rr);
-		pressed = hover && (p->mousebuttons & 1);
-		leftmods[i]->draw(p, leftmods[i], dst, rr, hover, pressed);
+static void
+drawmod(Panel *p, Pmod *m, Image *dst)
+{
+	int hover, pressed;
+
+	hover = ptinrect(p->mousexy, m->last);
+	pressed = hover && (p->mousebuttons & 1);
+	m->draw(p, m, dst, m->last, hover, pressed);
+}
+
+/* lay out one stack from x; returns the x after its last gap */
+static int
+layoutstack(Panel *p, Rectangle tr, Pmod **mods, int n, int side, int x)
+{
+	int i;
 
-		x += leftmods[i]->w + p->gap;
+	for(i=0; i<n; i++){
+		mods[i]->last = Rect(x, tr.min.y+2, x + mods[i]->w, tr.max.y-2);
+		if(mods[i]->clickable)
+			ui9_hitadd(&p->ui, mods[i]->last, HitMod | side<<8 | i);
+		x += mods[i]->w + p->gap;
 	}
+	return x;
+}
 
-	/* right stack */
-	x = tr.max.x - p->gap - sumw(p, rightmods, nright);
-	for(i=0; i<nright; i++){
-		rr = Rect(x, tr.min.y+2, x + rightmods[i]->w, tr.max.y-2);
-		rightmods[i]->last = rr;
+/*
+ * Repaint one stack: all of it, over the union of its old and new
+ * extent, when a width changed; else just the dirty modules' columns.
+ */
+static void
+damagestack(Panel *p, Image *dst, Rectangle tr, Pmod **mods, int n, int side, Rectangle span)
+{
+	Rectangle r;
+	int i;
 
-		hover = ptinrect(p->mousexy, rr);
-		pressed = hover && (p->mousebuttons & 1);
-		rightmods[i]->draw(p, rightmods[i], dst, rr, hover, pressed);
+	if(p->sidedirty[side]){
+		r = span;
+		if(Dx(p->span[side]) > 0)
+			combinerect(&r, p->span[side]);
+		paintbg(p, dst, tr, r);
+		for(i=0; i<n; i++)
+			drawmod(p, mods[i], dst);
+		adddamage(p, r);
+		return;
+	}
+	for(i=0; i<n; i++){
+		if(!mods[i]->dirty)
+			continue;
+		r = Rect(mods[i]->last.min.x, tr.min.y, mods[i]->last.max.x, tr.max.y);
+		paintbg(p, dst, tr, r);
+		drawmod(p, mods[i], dst);
+		adddamage(p, r);
+	}
+}
+
+static void
+drawpanel(Panel *p, Pmod **leftmods, int nleft, Pmod **rightmods, int nright)
+{
+	Rectangle wr, tr, mr, span[2];
+	Image *dst;
+	int i, x, full;
+
+	wr = p->dst->r;
+	p->r = wr;
+
+	tr = wr;
+	tr.max.y = tr.min.y + p->baseh;
+	mr = tr;
+	mr.min.y = tr.max.y;
+	mr.max.y = mr.min.y + expandh(p);
+
+	bufrealloc(p);
+	dst = (p->buf != nil) ? p->buf : p->dst;
+	ui9_begin(&p->ui, dst);
+	ui9_hitreset(&p->ui, wr);
+
+	/* markdirty (reload, expand, clicks) and resizes repaint everything */
+	full = p->full || p->buf == nil || !eqrect(wr, p->lastr);
 
-		x += rightmods[i]->w + p->gap;
+	/* layout is cheap (widths come from measure): rects + hits every frame */
+	x = layoutstack(p, tr, leftmods, nleft, 0, tr.min.x + p->gap);
+	span[0] = Rect(tr.min.x, tr.min.y, x, tr.max.y);
+	x = tr.max.x - p->gap - sumw(p, rightmods, nright);
+	span[1] = Rect(x - p->gap, tr.min.y, tr.max.x, tr.max.y);
+	layoutstack(p, tr, rightmods, nright, 1, x);
+
+	p->ndmg = 0;
+	if(full){
+		paintbg(p, dst, tr, tr);
+		for(i=0; i<nleft; i++)
+			drawmod(p, leftmods[i], dst);
+		for(i=0; i<nright; i++)
+			drawmod(p, rightmods[i], dst);
+		adddamage(p, wr);
+	}else{
+		damagestack(p, dst, tr, leftmods, nleft, 0, span[0]);
+		damagestack(p, dst, tr, rightmods, nright, 1, span[1]);
+	}
+	if(p->ndmg > 0 && ui9visible(&p->ui, Ui9CBorder)){
+		border(dst, tr, 1, ui9img(&p->ui, Ui9CBorder), ZP);
+		p->ui.nops++;
 	}
 
-	/* mini list */
-	if(p->expanded && Dy(wr) >= (p->baseh + p->minih)){
-		mr = wr;
-		mr.min.y = tr.max.y;
-		mr.max.y = mr.min.y + p->minih;
-		drawminibar(p, mr);
+	/* mini list or notifications */
+	if(p->expanded && Dy(wr) >= Dy(tr) + Dy(mr) && (full || p->minidirty)){
+		if(p->notesopen)
+			drawnotes(p, mr);
+		else
+			drawminibar(p, mr);
+		if(!full)
+			adddamage(p, mr);
 	}
 
-	/* blit */
+	/* blit only what was repainted */
+	p->blitpx = 0;
 	if(p->buf != nil)
-		draw(p->dst, wr, p->buf, nil, ZP);
+		for(i=0; i<p->ndmg; i++){
+			draw(p->dst, p->dmg[i], p->buf, nil, p->dmg[i].min);
+			p->blitpx += Dx(p->dmg[i]) * Dy(p->dmg[i]);
+			p->ui.nops++;
+		}
 
+	p->flushed = display->bufp - display->buf;
 	flushimage(display, 1);
 	p->dirty = 0;
+	p->full = 0;
+	p->minidirty = 0;
+	p->sidedirty[0] = p->sidedirty[1] = 0;
+	for(i=0; i<nleft; i++)
+		leftmods[i]->dirty = 0;
+	for(i=0; i<nright; i++)
+		rightmods[i]->dirty = 0;
+	p->span[0] = span[0];
+	p->span[1] = span[1];
+	p->lastr = wr;
+
+	p->frameops = p->ui.nops;
+	if(p->stats)
+		fprint(2, "9de-panel: frame ops %lud blit %ldpx events %d merged %d (total %lud/%lud) resize %d/min bufs %lud\n",
+			p->frameops, p->blitpx, p->ev.nread, p->ev.nmerged, p->ev.read, p->ev.merged,
+			p->rzlast, p->bufallocs);
 }
 
+/*
+ * Expand/collapse debounce: ws_hover has to hold for expandms (be
+ * gone for collapsems) before the window is resized, and flipping back
+ * within the delay cancels the transition, so jitter on the boundary
+ * writes no resize at all. A pending transition is resolved by the next
+ * mouse event or tick.
+ */
 static void
 maybeexpand(Panel *p)
 {
-	int want = p->ws_hover;
+	vlong now;
+	int want;
 
-	if(want && !p->expanded){
-		p->expanded = 1;
-		p->h = p->baseh + p->minih;
-		setpanelheight(p, p->h);
-		p->dirty = 1;
-	}else if(!want && p->expanded){
-		p->expanded = 0;
-		p->h = p->baseh;
-		setpanelheight(p, p->h);
-		p->dirty = 1;
+	now = p->bench ? p->benchms : ui9nowms();
+	if(now - p->rzmin >= 60*1000){
+		p->rzlast = p->rzn;
+		p->rzn = 0;
+		p->rzmin = now;
+	}
+
+	want = p->ws_hover || p->notesopen;
+	if(want == p->expanded){
+		p->xpend = 0;
+		/* switched between the mini list and notifications */
+		if(want && p->h != p->baseh + expandh(p)){
+			p->h = p->baseh + expandh(p);
+			setpanelheight(p, p->h);
+			markdirty(p);
+		}
+		p->xnotes = p->notesopen;
+		return;
 	}
+	if(!p->xpend){
+		p->xpend = 1;
+		p->xdue = now + (want ? p->expandms : p->collapsems);
+		if(p->notesopen != p->xnotes)
+			p->xdue = now;    /* a click, not a hover */
+	}
+	if(now < p->xdue)
+		return;
+	p->xpend = 0;
+	p->expanded = want;
+	p->xnotes = p->notesopen;
+	p->winsel = -1;
+	p->h = want ? p->baseh + expandh(p) : p->baseh;
+	setpanelheight(p, p->h);
+	p->dirty = 1;
+	p->full = 1;
+}
+
+/* re-measure a stack; 1 if any width changed (the whole side moves) */
+static int
+measurestack(Panel *p, Pmod **mods, int n)
+{
+	int i, w, moved;
+
+	moved = 0;
+	for(i=0; i<n; i++){
+		if(mods[i] == nil || mods[i]->measure == nil)
+			continue;
+		w = mods[i]->w;
+		mods[i]->measure(p, mods[i]);
+		if(mods[i]->w != w)
+			moved = 1;
+	}
+	return moved;
+}
+
+static Pmod*
+hitmod(Panel *p, ulong id)
+{
+	if((id & HitKind) != HitMod)
+		return nil;
+	if((id>>8 & 1) == 0 && (id & 0xFF) < p->nleft)
+		return p->leftmods[id & 0xFF];
+	if((id>>8 & 1) == 1 && (id & 0xFF) < p->nright)
+		return p->rightmods[id & 0xFF];
+	return nil;
+}
+
+/* hover/press feedback: repaint just the thing under id */
+static void
+damageid(Panel *p, ulong id)
+{
+	Pmod *pm;
+
+	switch(id & HitKind){
+	case HitWin:
+		p->minidirty = 1;
+		break;
+	case HitMod:
+		if((pm = hitmod(p, id)) != nil)
+			pm->dirty = 1;
+		break;
+	default:
+		return;
+	}
+	p->dirty = 1;
 }
 
 static void
 onmouse(Panel *p, Mouse *m, Pmod **leftmods, int nleft, Pmod **rightmods, int nright)
 {
-	int i;
-	Rectangle mr, tr;
+	ulong id;
+	int ob, ofocus;
+	Pmod *pm;
+	Rectangle mr, tr, hr;
 
+	ob = p->mousebuttons;
+	ofocus = p->focus_menu;
 	p->mousexy = m->xy;
 	p->mousebuttons = m->buttons;
 
 	tr = p->r;
 	tr.max.y = tr.min.y + p->baseh;
 
-	p->ws_hover = 0;
-	if(ptinrect(m->xy, p->wsrect))
-		p->ws_hover = 1;
-
+	/*
+	 * hysteresis: enter on the ws chip itself; once expanded, stay
+	 * while on the chip (with slack), the strip down to the mini list,
+	 * or the mini list
+	 */
+	p->ws_hover = ptinrect(m->xy, p->wsrect);
 	if(p->expanded){
 		mr = p->r;
 		mr.min.y = tr.max.y;
-		mr.max.y = mr.min.y + p->minih;
-		if(ptinrect(m->xy, mr))
+		mr.max.y = mr.min.y + expandh(p);
+		hr = insetrect(p->wsrect, -HoverSlack);
+		hr.max.y = mr.min.y;
+		if(ptinrect(m->xy, hr) || ptinrect(m->xy, mr))
 			p->ws_hover = 1;
 
-		if(hitminibar(p, mr, m)){
-			markdirty(p);
-			return;
+		/* wheel over the mini list scrolls it by about a chip */
+		if(ptinrect(m->xy, mr) && (m->buttons & ~ob & (8|16))){
+			if(p->notesopen){
+				p->notescroll += (m->buttons & 8) ? -1 : 1;
+				p->minidirty = 1;
+				p->dirty = 1;
+			}else
+				winscrollby(p, (m->buttons & 8) ? -p->win_maxw/2 : p->win_maxw/2);
 		}
 	}
 
-	for(i=0; i<nleft; i++){
-		if(leftmods[i]->hit != nil && leftmods[i]->hit(p, leftmods[i], m, leftmods[i]->last)){
+	/* rects from the last frame: no layout or text measuring here */
+	id = ui9_hit(&p->ui, m->xy);
+
+	/* redraw for hover/press feedback only when it changes */
+	if(id != p->hoverid){
+		damageid(p, p->hoverid);
+		damageid(p, id);
+	}else if(m->buttons != ob)
+		damageid(p, id);
+	p->hoverid = id;
+	switch(id & HitKind){
+	case HitWin:
+		if(p->expanded && (m->buttons & ~ob & 1)){   /* press edge: one wctl write per click */
+			focuswin(id & ~HitKind);
 			markdirty(p);
 			return;
 		}
-	}
-	for(i=0; i<nright; i++){
-		if(rightmods[i]->hit != nil && rightmods[i]->hit(p, rightmods[i], m, rightmods[i]->last)){
+		break;
+	case HitMod:
+		/* a press, not a held button: each hit toggles or launches */
+		pm = hitmod(p, id);
+		if(pm != nil && pm->hit != nil && (m->buttons & ~ob & 1) && pm->hit(p, pm, m, pm->last)){
 			markdirty(p);
+			maybeexpand(p);    /* notif opens/closes its list at once */
 			return;
 		}
+		break;
 	}
 
 	if((m->buttons & 1) && nleft > 0 && strcmp(leftmods[0]->name, "menu")==0){
@@ -1577,6 +2706,10 @@ onmouse(Panel *p, Mouse *m, Pmod **leftmods, int nleft, Pmod **rightmods, int nr
 			p->focus_menu = 1;
 		else
 			p->focus_menu = 0;
+		if(p->focus_menu != ofocus){
+			leftmods[0]->dirty = 1;
+			p->dirty = 1;
+		}
 	}
 
 	maybeexpand(p);
@@ -1585,6 +2718,45 @@ onmouse(Panel *p, Mouse *m, Pmod **leftmods, int nleft, Pmod **rightmods, int nr
 static void
 onkey(Panel *p, Rune r)
 {
+	int i;
+
+	if(r == Kesc && p->notesopen){
+		p->notesopen = 0;
+		p->minidirty = 1;
+		p->dirty = 1;
+		return;
+	}
+
+	/* mini list open: arrows move the selection, enter focuses it */
+	if(p->expanded && !p->notesopen && p->nwins > 0){
+		i = p->winsel;
+		if(i < 0)
+			for(i=0; i<p->nwins-1; i++)
+				if(p->wins[i].current)
+					break;
+		switch(r){
+		case Kleft:
+			winselect(p, p->winsel < 0 ? i : i-1);
+			return;
+		case Kright:
+			winselect(p, p->winsel < 0 ? i : i+1);
+			return;
+		case Khome:
+			winselect(p, 0);
+			return;
+		case Kend:
+			winselect(p, p->nwins-1);
+			return;
+		case '\n':
+			if(p->winsel >= 0){
+				focuswin(p->wins[p->winsel].id);
+				markdirty(p);
+				return;
+			}
+			break;
+		}
+	}
+
 	switch(r){
 	case 'd':
 		ensurelogdir();
@@ -1609,28 +2781,143 @@ onkey(Panel *p, Rune r)
 
 /* ----------------- timers ----------------- */
 
+/*
+ * Timers only update the model; setlabel/updatewins mark the panel
+ * dirty when something visible changed, so an idle panel redraws once
+ * a second, for the clock.
+ */
+static void
+tickclock(void *arg)
+{
+	fmtclock(arg);
+}
+
 static void
-tick1hz(void *arg)
+tickws(void *arg)
 {
 	Panel *p = arg;
 
-	fmtclock(p);
-	fmtnet(p);
-	if(access("/srv/9de", AEXIST) != 0){
-		p->de_up = 0;
-		snprint(p->de_label, sizeof p->de_label, "de: down");
+	if(!p->winsrv)
+		updatewins(p);
+	else if(p->winsync){
+		p->winsync = 0;
+		readsrvwins(p);
 	}
+	maybeexpand(p);
+}
 
-	markdirty(p);
+/* ----------------- bench ----------------- */
+
+/*
+ * 9de-panel -b trace: replay a session offscreen and print one CSV row
+ * per frame drawn. Trace lines are "ms op args", ms being trace time
+ * (the clock label and expand/collapse delays follow it):
+ *
+ *   ms mouse x y buttons   pointer event, panel coordinates
+ *   ms tick                clock + window tick
+ *   ms wins n              the next n lines are a windows snapshot
+ *                          ("id current|- label", as /mnt/9de/windows)
+ *   ms event line          a /srv/9de event ("ok setpreset dark", "err x")
+ *   ms reload              config reload, as on "ok reload"
+ *
+ * Sources are stubbed: no /dev/wsys, wctl, /srv/9de, status polling or
+ * external modules; resizes allocate a new offscreen image. Columns:
+ * frame time ns, draw ops, pixels blitted, bytes in the final flush
+ * (libdraw flushes a full buffer early), allocimage calls and the heap
+ * growth over the frame.
+ */
+static void
+benchframe(Panel *p, int frame)
+{
+	vlong t0, t1;
+	uintptr heap;
+	ulong img;
+
+	if(p->remeasure){
+		p->remeasure = 0;
+		p->sidedirty[0] |= measurestack(p, p->leftmods, p->nleft);
+		p->sidedirty[1] |= measurestack(p, p->rightmods, p->nright);
+	}
+	heap = mainmem->curalloc;
+	img = nimg;
+	t0 = nsec();
+	drawpanel(p, p->leftmods, p->nleft, p->rightmods, p->nright);
+	t1 = nsec();
+	print("%d,%lld,%lld,%lud,%ld,%ld,%lud,%lld\n", frame, p->benchms, t1-t0,
+		p->frameops, p->blitpx, p->flushed, nimg-img, (vlong)mainmem->curalloc - (vlong)heap);
 }
 
 static void
-tickws(void *arg)
+benchmain(Panel *p, char *path)
 {
-	Panel *p = arg;
-	updatewins(p);
-	maybeexpand(p);
-	markdirty(p);
+	Biobuf *b;
+	Mouse m;
+	char *ln, *s, *f[4];
+	int nf, frames, i;
+	vlong t0;
+	Font *fnt;
+
+	b = Bopen(path, OREAD);
+	if(b == nil)
+		sysfatal("open %s: %r", path);
+
+	fnt = font;
+	ui9font_preload(fnt, panelglyphs);
+	ui9init(&p->ui, display, fnt);
+	benchresize(p, p->h);
+	applyappearance(p, fnt);
+	fmtclock(p);
+	fmtpreset(p);
+	initmods(p);
+	measurestack(p, p->leftmods, p->nleft);
+	measurestack(p, p->rightmods, p->nright);
+
+	print("frame,ms,ns,ops,blitpx,flushed,allocimage,heap\n");
+	frames = 0;
+	t0 = nsec();
+	benchframe(p, frames++);
+	while((ln = Brdline(b, '\n')) != nil){
+		ln[Blinelen(b)-1] = 0;
+		if(ln[0] == '#' || ln[0] == 0)
+			continue;
+		p->benchms = strtoll(ln, &s, 10);
+		while(*s == ' ')
+			s++;
+		if(strncmp(s, "event ", 6) == 0){
+			srvevent(p, s+6);
+			p->winsync = 0;
+		}else if((nf = tokenize(s, f, nelem(f))) < 1)
+			continue;
+		else if(strcmp(f[0], "mouse") == 0 && nf == 4){
+			memset(&m, 0, sizeof m);
+			m.xy = addpt(p->dst->r.min, Pt(atoi(f[1]), atoi(f[2])));
+			m.buttons = atoi(f[3]);
+			m.msec = p->benchms;
+			onmouse(p, &m, p->leftmods, p->nleft, p->rightmods, p->nright);
+		}else if(strcmp(f[0], "tick") == 0){
+			fmtclock(p);
+			tickws(p);
+		}else if(strcmp(f[0], "wins") == 0 && nf == 2){
+			parsewins(p, b, atoi(f[1]));
+			for(i=0; i<p->nwins; i++)
+				if(p->wins[i].current)
+					break;
+			if(i == p->nwins)
+				setlabel(p, p->ws_label, sizeof p->ws_label, "ws");
+		}else if(strcmp(f[0], "reload") == 0)
+			reloadpanel(p, fnt);
+
+		if(p->need_reload){
+			p->need_reload = 0;
+			reloadpanel(p, fnt);
+		}
+		if(p->dirty)
+			benchframe(p, frames++);
+	}
+	Bterm(b);
+	fprint(2, "9de-panel: bench %s: %d frames in %lldms, %d resizes\n",
+		path, frames, (nsec()-t0)/1000000, p->rzn);
+	exits(nil);
 }
 
 /* ----------------- entry ----------------- */
@@ -1638,7 +2925,7 @@ tickws(void *arg)
 static void
 usage(void)
 {
-	fprint(2, "usage: 9de-panel\n");
+	fprint(2, "usage: 9de-panel [-b trace]\n");
 	exits("usage");
 }
 
@@ -1646,74 +2933,41 @@ void
 main(int argc, char **argv)
 {
 	Panel p;
-	Event e;
 	Ui9Sched sched;
-	vlong now;
-	long next;
+	ulong timer;
 	char *ltmp, *rtmp;
 	char *lw[MaxMods], *rw[MaxMods];
 	Pmod *leftmods[MaxMods], *rightmods[MaxMods];
 	int nleft, nright;
 	int i;
 	Font *fnt;
+	char *bench;
 
+	bench = nil;
 	ARGBEGIN{
+	case 'b':
+		bench = EARGF(usage());
+		break;
 	default:
 		usage();
 	}ARGEND
 
 	memset(&p, 0, sizeof p);
+	p.bench = bench != nil;
+	p.winsel = -1;
 
-	setcfgdefaults(&p);
-
-	/* load config file */
-	loadconfig(&p);
-
-	/* env overrides (dev / session can export) */
-	if(getenv("panel_left") != nil)   strecpy(p.panel_left_cfg, p.panel_left_cfg+sizeof p.panel_left_cfg, getenv("panel_left"));
-	if(getenv("panel_right") != nil)  strecpy(p.panel_right_cfg, p.panel_right_cfg+sizeof p.panel_right_cfg, getenv("panel_right"));
-	if(getenv("panel_height") != nil) p.baseh = atoi(getenv("panel_height"));
-	if(getenv("panel_minih") != nil)  p.minih = atoi(getenv("panel_minih"));
-	if(getenv("panel_ascii") != nil)  p.ascii = 1;
-
-	/* allow env for appearance too */
-	if(getenv("ui_style") != nil)     strecpy(p.ui_style_name, p.ui_style_name+sizeof p.ui_style_name, getenv("ui_style"));
-	if(getenv("ui_alpha") != nil)     p.ui_alpha = atoi(getenv("ui_alpha"));
-	if(getenv("ui_accent") != nil)    strecpy(p.ui_accent, p.ui_accent+sizeof p.ui_accent, getenv("ui_accent"));
-	if(getenv("ui_topbg") != nil)     strecpy(p.ui_topbg, p.ui_topbg+sizeof p.ui_topbg, getenv("ui_topbg"));
-	if(getenv("ui_toptext") != nil)   strecpy(p.ui_toptext, p.ui_toptext+sizeof p.ui_toptext, getenv("ui_toptext"));
-	if(getenv("ui_border_alpha") != nil) p.ui_border_alpha = atoi(getenv("ui_border_alpha"));
-	if(getenv("ui_shadow_alpha") != nil) p.ui_shadow_alpha = atoi(getenv("ui_shadow_alpha"));
-	if(getenv("ui_radius") != nil)    p.ui_radius = atoi(getenv("ui_radius"));
-	if(getenv("ui_font") != nil)      strecpy(p.ui_font_path, p.ui_font_path+sizeof p.ui_font_path, getenv("ui_font"));
-
-	if(getenv("ui_topgrad") != nil)   p.ui_topgrad = atoi(getenv("ui_topgrad")) != 0;
-	if(getenv("ui_topgrad0") != nil)  strecpy(p.ui_topgrad0, p.ui_topgrad0+sizeof p.ui_topgrad0, getenv("ui_topgrad0"));
-	if(getenv("ui_topgrad1") != nil)  strecpy(p.ui_topgrad1, p.ui_topgrad1+sizeof p.ui_topgrad1, getenv("ui_topgrad1"));
-
-	if(getenv("ui_minigrad") != nil)  p.ui_minigrad = atoi(getenv("ui_minigrad")) != 0;
-	if(getenv("ui_minigrad0") != nil) strecpy(p.ui_minigrad0, p.ui_minigrad0+sizeof p.ui_minigrad0, getenv("ui_minigrad0"));
-	if(getenv("ui_minigrad1") != nil) strecpy(p.ui_minigrad1, p.ui_minigrad1+sizeof p.ui_minigrad1, getenv("ui_minigrad1"));
-
-	if(p.baseh <= 16) p.baseh = PanelHDefault;
-	if(p.minih < 16)  p.minih = MiniHDefault;
-	p.h = p.baseh;
+	loadcfg(&p);
 
 	if(initdraw(0, 0, "9de-panel") < 0)
 		sysfatal("initdraw: %r");
+	if(bench != nil)
+		benchmain(&p, bench);
 
 	einit(Emouse|Ekeyboard|Eresize);
+	timer = etimer(0, TickMs);
 
-	/* optional font override */
-	fnt = font; /* draw(3) default */
-	if(p.ui_font_path[0] != 0){
-		Font *nf = openfont(display, p.ui_font_path);
-		if(nf != nil)
-			fnt = nf;
-		else
-			fprint(2, "9de-panel: openfont %s failed: %r\n", p.ui_font_path);
-	}
-
+	fnt = font; /* draw(3) default; applyappearance applies ui_font */
+	ui9font_preload(fnt, panelglyphs);
 	ui9init(&p.ui, display, fnt);
 
 	p.dst = screen;
@@ -1722,20 +2976,20 @@ main(int argc, char **argv)
 	applyappearance(&p, fnt);
 
 	fmtclock(&p);
-	fmtnet(&p);
 	fmtde(&p);
 	fmtpreset(&p);
 	updatewins(&p);
 
 	setpanelheight(&p, p.h);
 	startsrvwatcher(&p);
+	atnotify(extnote, 1);     /* external module deadlines */
 
 	initmods(&p);
 
 	ui9schedinit(&sched);
-	ui9schedadd(&sched, 0, 1000, tick1hz, &p);
-	ui9schedadd(&sched, 0, 250, tickws, &p);
-	ui9schedadd(&sched, 0, 33, markdirty, &p);
+	ui9schedadd(&sched, 0, TickMs, tickclock, &p);
+	ui9schedadd(&sched, 0, TickMs, ticksrc, &p);
+	ui9schedadd(&sched, 0, TickMs, tickws, &p);
 
 	for(i=0; i<p.nleft; i++) if(p.leftmods[i] && p.leftmods[i]->measure) p.leftmods[i]->measure(&p, p.leftmods[i]);
 	for(i=0; i<p.nright; i++) if(p.rightmods[i] && p.rightmods[i]->measure) p.rightmods[i]->measure(&p, p.rightmods[i]);
@@ -1743,25 +2997,27 @@ main(int argc, char **argv)
 	p.dirty = 1;
 
 	for(;;){
-		now = ui9nowms();
-		next = ui9schednext(&sched, now);
-		if(next < 0) next = 200;
-		alarm(next);
-
-		while(ecanread()){
-			switch(event(&e)){
-			case Eresize:
-				eresized(0);
-				p.dst = screen;
-				ui9setdst(&p.ui, p.dst);
-				bufrealloc(&p);
-				p.dirty = 1;
+		/* sleep until input or the tick; one batch per frame, motion coalesced */
+		p.ev.datakeys = p.watchkey;
+		ui9_drain(&p.ev, Emouse|Ekeyboard|Eresize|timer|p.watchkey, 1);
+		if(p.ev.resized){
+			eresized(0);
+			p.dst = screen;
+			ui9setdst(&p.ui, p.dst);
+			bufrealloc(&p);
+			p.dirty = 1;
+			p.full = 1;    /* rio may hand back a window with nothing in it */
+		}
+		for(i=0; i<p.ev.n; i++){
+			switch(p.ev.e[i].type){
+			case Ui9EvMouse:
+				onmouse(&p, &p.ev.e[i].m, p.leftmods, p.nleft, p.rightmods, p.nright);
 				break;
-			case Emouse:
-				onmouse(&p, &e.mouse, p.leftmods, p.nleft, p.rightmods, p.nright);
+			case Ui9EvKey:
+				onkey(&p, p.ev.e[i].k);
 				break;
-			case Ekeyboard:
-				onkey(&p, e.kbdc);
+			case Ui9EvData:
+				srvmsg(&p, p.ev.e[i].data, p.ev.e[i].n);
 				break;
 			}
 		}
@@ -1773,8 +3029,11 @@ main(int argc, char **argv)
 			reloadpanel(&p, fnt);
 		}
 
-		for(i=0; i<p.nleft; i++) if(p.leftmods[i] && p.leftmods[i]->measure) p.leftmods[i]->measure(&p, p.leftmods[i]);
-		for(i=0; i<p.nright; i++) if(p.rightmods[i] && p.rightmods[i]->measure) p.rightmods[i]->measure(&p, p.rightmods[i]);
+		if(p.remeasure){
+			p.remeasure = 0;
+			p.sidedirty[0] |= measurestack(&p, p.leftmods, p.nleft);
+			p.sidedirty[1] |= measurestack(&p, p.rightmods, p.nright);
+		}
 
 		if(p.dirty)
 			drawpanel(&p, p.leftmods, p.nleft, p.rightmods, p.nright);
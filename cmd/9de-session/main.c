@@ -1,6 +1,8 @@
 #include <u.h>
 #include <libc.h>
 
+#include "../../include/9deui/cfg.h"
+
 /*
  * 9de-session (early)
  *
@@ -106,31 +108,10 @@ readfile(char *path)
 	return buf;
 }
 
-static int
-cfgget_int(char *cfg, char *key, int def)
-{
-	char *p, *e;
-	int klen;
-
-	if(cfg == nil) return def;
-	klen = strlen(key);
-
-	for(p = cfg; *p; p++){
-		/* line start or after \n */
-		if(p != cfg && p[-1] != '\n')
-			continue;
-		if(*p == '#')
-			continue;
-		if(strncmp(p, key, klen) != 0)
-			continue;
-		if(p[klen] != '=')
-			continue;
-		e = strchr(p, '\n');
-		if(e == nil) e = p + strlen(p);
-		return atoi(p + klen + 1);
-	}
-	return def;
-}
+static Ui9CfgKey sessionkeys[] = {
+	{ "start_shell", Ui9CfgBool, "1" },
+	{ "start_demo",  Ui9CfgBool, "1" },
+};
 
 static void
 paths(char *dir, int ndir, char *defaults, int ndef, char *config, int ncfg, char *auto1, int nauto)
@@ -183,16 +164,18 @@ static void
 cmd_gen(void)
 {
 	char dir[512], defaults[512], config[512], auto1[512];
-	char *dflt, *cfg;
+	Ui9Cfg *cfg;
 	int start_shell, start_demo;
 
 	paths(dir, sizeof dir, defaults, sizeof defaults, config, sizeof config, auto1, sizeof auto1);
 
-	dflt = readfile(defaults);
-	cfg = readfile(config);
-
-	start_shell = cfgget_int(cfg, "start_shell", cfgget_int(dflt, "start_shell", 1));
-	start_demo  = cfgget_int(cfg, "start_demo",  cfgget_int(dflt, "start_demo", 1));
+	/* one pass per file; config.rc overrides defaults.rc */
+	cfg = ui9cfg_new(sessionkeys, nelem(sessionkeys));
+	ui9cfg_file(cfg, defaults);
+	ui9cfg_file(cfg, config);
+	start_shell = ui9cfg_bool(cfg, "start_shell");
+	start_demo  = ui9cfg_bool(cfg, "start_demo");
+	ui9cfg_free(cfg);
 
 	/* generate autostart */
 	{
@@ -237,8 +220,6 @@ snprint(out, sizeof out,
 		if(writefile_atomic(auto1, out) < 0)
 			sysfatal("write %s: %r", auto1);
 	}
-free(dflt);
-	free(cfg);
 
 	fprint(1, "9de-session: generated %s\n", auto1);
 	fprint(1, "  start_shell=%d start_demo=%d\n", start_shell, start_demo);
@@ -3,6 +3,8 @@
 #include <thread.h>
 
 #include "srv9p.h"
+#include "../../include/9deui/wsys.h"
+#include "../../include/9deui/cfg.h"
 
 /*
  * 9de-shell (contract owner, early)
@@ -10,9 +12,28 @@
  * Owns placement + start order:
  *   - panel pinned to edge
  *   - dash is launched/toggled by panel (early)
+ * Owns the one /dev/wsys watcher: clients read /srv/9de windows and
+ * follow "win ..." lines on events instead of polling rio themselves.
  * Later: notifications, modules, workspace metadata.
  */
 
+enum { WinPollMs = 250 };
+
+static Ui9CfgKey shellkeys[] = {
+	{ "shell_events",   Ui9CfgInt,  "128", 16, 65536 },   /* events ring, shared by all subscribers */
+	{ "shell_lossless", Ui9CfgBool, "0" },
+
+	/* published under /srv/9de state/theme, unset unless configured */
+	{ "ui_accent",        Ui9CfgStr },
+	{ "ui_alpha",         Ui9CfgStr },
+	{ "ui_radius",        Ui9CfgStr },
+	{ "ui_topbg",         Ui9CfgStr },
+	{ "ui_toptext",       Ui9CfgStr },
+	{ "ui_border_alpha",  Ui9CfgStr },
+	{ "ui_shadow_alpha",  Ui9CfgStr },
+};
+
+
 static char*
 userhome(void)
 {
@@ -24,6 +45,51 @@ userhome(void)
 	return home;
 }
 
+/* render the windows file and post one event per delta */
+static void
+publishwins(Ui9Wsys *w)
+{
+	Ui9WinDelta *d;
+	Ui9Win *x;
+	char *buf, *p, *e;
+	int i, n;
+
+	n = w->nwin*(Ui9WinLabel+24) + 1;
+	buf = malloc(n);
+	if(buf == nil)
+		return;
+	p = buf;
+	e = buf + n;
+	*p = 0;
+	for(i=0; i<w->nwin; i++)
+		p = seprint(p, e, "%d %s %s\n", w->win[i].id,
+			w->win[i].current ? "current" : "-", w->win[i].label);
+	srv9psetwindows(buf);
+	free(buf);
+
+	for(i=0; i<w->nd; i++){
+		d = &w->d[i];
+		x = ui9wsys_find(w, d->id);
+		switch(d->op){
+		case Ui9WinAdd:
+			srv9ppostevent("win add %d %s", d->id, x ? x->label : "");
+			break;
+		case Ui9WinDel:
+			srv9ppostevent("win del %d", d->id);
+			break;
+		case Ui9WinTitle:
+			srv9ppostevent("win title %d %s", d->id, x ? x->label : "");
+			break;
+		case Ui9WinFocus:
+			if(d->id < 0)
+				srv9ppostevent("win focus -");
+			else
+				srv9ppostevent("win focus %d", d->id);
+			break;
+		}
+	}
+}
+
 static void
 spawnrc(char *cmd)
 {
@@ -42,6 +108,10 @@ void threadmain(int argc, char **argv)
 {
 	int dev = 0;
 	char cmd[2048];
+	Ui9Wsys *w;
+	Ui9Cfg *c;
+	char *v;
+	int i;
 
 	ARGBEGIN{
 	case 'd':
@@ -50,7 +120,13 @@ void threadmain(int argc, char **argv)
 	}ARGEND
 
 	/* start control plane (/srv/9de) */
-	srv9pstart();
+	c = ui9cfg_load(shellkeys, nelem(shellkeys), 1);
+	for(i=0; i<nelem(shellkeys); i++)
+		if(strncmp(shellkeys[i].name, "ui_", 3) == 0 && (v = ui9cfg_str(c, shellkeys[i].name)) != nil
+		&& srv9psettheme(shellkeys[i].name+3, v) < 0)
+			fprint(2, "9de-shell: %s=%s: bad value\n", shellkeys[i].name, v);
+	srv9pstart(ui9cfg_int(c, "shell_events"), ui9cfg_bool(c, "shell_lossless"));
+	ui9cfg_free(c);
 	srv9ppostevent("shell boot");
 
 	/* start panel pinned top with split logs */
@@ -68,6 +144,12 @@ void threadmain(int argc, char **argv)
 		spawnrc(cmd);
 	}
 
-	for(;;) sleep(1000);
+	/* the single window watcher for every 9DE surface */
+	w = ui9wsys_open(nil);
+	for(;;){
+		if(ui9wsys_update(w) > 0)
+			publishwins(w);
+		sleep(WinPollMs);
+	}
 	threadexits(nil);
 }
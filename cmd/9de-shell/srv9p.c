@@ -10,25 +10,90 @@
  *
  * Files:
  *   ctl    (write commands)
- *   status (read state)
+ *   status (read state, v0: "preset x\npanel y\n")
  *   events (read line stream)
+ *   windows (read: "id current|- label" per window, from the shell's watcher)
+ *   state/preset, state/panel     one value each
+ *   state/theme/<key>             ui_<key> overrides, empty if unset
+ *   state/windows/<id>            "current|- label" for one window
  *
  * This is intentionally small: lock down the interface early.
+ *
+ * The 9P server runs in its own proc; lk guards everything the shell's
+ * main proc also touches (event ring, subscribers, window list).
+ *
+ * events is a broadcast: every open fid is a subscriber with its own
+ * cursor into one sequence-numbered ring, so each reader sees every
+ * event posted after its open. A read returns as many whole lines as
+ * fit in count and ignores the offset; with nothing new it is queued on
+ * the fid until the next post (or a flush).
+ *
+ * The ring holds the last qn events (shell_events). A subscriber that
+ * falls further behind gets "lost N" before the events it still can
+ * read, so it knows to resync from status/windows. In lossless mode
+ * (shell_lossless=1) a state event (preset, panel, focus, a window's
+ * title) that nobody has read yet is dropped and its newer value takes
+ * the tail instead of a new slot, so it still follows everything posted
+ * before it ("win add 7" before "win focus 7"); a full ring grows (up
+ * to QGrow times) rather than overwrite unread events.
+ *
+ * Every readable file other than events is a state file: its aux holds
+ * the rendered bytes, which are replaced only when a mutation changes
+ * them, and each replacement bumps qid.vers. A client stats the files it
+ * follows and rereads only those whose version moved; a read is a copy
+ * from the cache and never re-renders.
  */
 
 static Srv fs;
 static Tree *t;
+static File *winsf, *statusf, *presetf, *panelf;
+static File *themedir, *windir;
+static QLock lk;
 
 static char preset[32] = "terminal";
 static char panel[16]  = "top";
 
-/* event queue (simple ring of small lines) */
-enum { QN = 128, QL = 160 };
-static char q[QN][QL];
-static int qh, qt;
-
-/* pending readers for /events */
-static Req *pend;
+/* state/theme: ui_<key> overrides as given, "" if unset */
+enum { ThemeInt, ThemeRGB };
+static struct {
+	char *key;
+	int type;
+	int min, max;
+	char val[16];
+	File *f;
+} theme[] = {
+	{ "accent",       ThemeRGB },
+	{ "alpha",        ThemeInt, 0, 255 },
+	{ "radius",       ThemeInt, 0, 24 },
+	{ "topbg",        ThemeRGB },
+	{ "toptext",      ThemeRGB },
+	{ "border_alpha", ThemeInt, 0, 255 },
+	{ "shadow_alpha", ThemeInt, 0, 255 },
+};
+
+/* event ring: event seq lives in q[seq % qn] */
+enum { QL = 160, QGrow = 8 };
+static char (*q)[QL];
+static int qn;
+static int qmax;           /* lossless: ring size limit */
+static int lossless;
+static uvlong qseq;        /* seq of the next event posted */
+static ulong qcoalesced;
+
+/* one per open events fid */
+typedef struct Sub Sub;
+struct Sub {
+	uvlong next;       /* seq of the next event this fid reads */
+	uvlong lost;       /* overrun, reported before the next events */
+	Req *pend;         /* queued reads, oldest first, linked by aux */
+	Req *pendt;
+	Sub *link;
+};
+static Sub *subs;
+
+/* state/windows/<id>, sorted by id; each holds the tree's and our reference */
+static File **wf;
+static int nwf;
 
 char*
 srv9preset(void){ return preset; }
@@ -36,31 +101,152 @@ srv9preset(void){ return preset; }
 char*
 srv9panel(void){ return panel; }
 
+/* copy whole lines from sub's cursor into r; 0 if nothing is new */
+static int
+fillread(Sub *sub, Req *r)
+{
+	char *s, buf[32];
+	long n, m;
+
+	/* overrun: the ring only holds the last qn */
+	if(qseq - sub->next > qn){
+		sub->lost += qseq - qn - sub->next;
+		sub->next = qseq - qn;
+	}
+	m = 0;
+	if(sub->lost > 0){
+		n = snprint(buf, sizeof buf, "lost %llud\n", sub->lost);
+		if(n <= r->ifcall.count){
+			memmove(r->ofcall.data, buf, n);
+			m = n;
+			sub->lost = 0;
+		}
+	}
+	while(sub->next < qseq){
+		s = q[sub->next % qn];
+		n = strlen(s);
+		if(m + n > r->ifcall.count){
+			if(m > 0)
+				break;
+			n = r->ifcall.count;    /* a line longer than count: cut it */
+		}
+		memmove(r->ofcall.data + m, s, n);
+		m += n;
+		sub->next++;
+	}
+	r->ofcall.count = m;
+	return m > 0;
+}
+
+/* state events: a later one with the same key supersedes an earlier one; key length, 0 if none */
+static int
+statekey(char *s)
+{
+	char *p;
+
+	if(strncmp(s, "ok setpreset ", 13) == 0)
+		return 12;
+	if(strncmp(s, "ok panel ", 9) == 0)
+		return 8;
+	if(strncmp(s, "win focus ", 10) == 0)
+		return 9;
+	if(strncmp(s, "ok theme ", 9) == 0 && (p = strpbrk(s+9, " \n")) != nil)
+		return p - s;
+	if(strncmp(s, "win title ", 10) == 0 && (p = strchr(s+10, ' ')) != nil)
+		return p - s;
+	return 0;
+}
+
+/* oldest seq a subscriber still needs, and the first one nobody has read */
+static void
+cursors(uvlong *min, uvlong *max)
+{
+	Sub *sub;
+
+	*min = qseq;
+	*max = qseq > qn ? qseq - qn : 0;
+	for(sub=subs; sub != nil; sub=sub->link){
+		if(sub->next < *min)
+			*min = sub->next;
+		if(sub->next > *max)
+			*max = sub->next;
+	}
+}
+
+/* double the ring, up to qmax; 0 if it cannot grow */
+static int
+qgrow(void)
+{
+	char (*nq)[QL];
+	uvlong s;
+	int nn;
+
+	nn = qn*2;
+	if(nn > qmax)
+		nn = qmax;
+	if(nn <= qn || (nq = malloc(nn * sizeof nq[0])) == nil)
+		return 0;
+	for(s = qseq > qn ? qseq - qn : 0; s < qseq; s++)
+		memmove(nq[s % nn], q[s % qn], QL);
+	free(q);
+	q = nq;
+	qn = nn;
+	return 1;
+}
+
+/*
+ * lossless: fold s into an unread event with its key; 1 if it was.
+ * Events after the old one move back a slot and s goes last, so the
+ * order against events about the same window is kept; nobody's cursor
+ * is past from, so no reader sees the shift.
+ */
+static int
+qcoalesce(char *s, uvlong from)
+{
+	char *e;
+	uvlong i;
+	int k;
+
+	if((k = statekey(s)) == 0)
+		return 0;
+	for(i=qseq; i > from; i--){
+		e = q[(i-1) % qn];
+		if(strncmp(e, s, k) == 0 && (e[k] == ' ' || e[k] == '\n')){
+			for(; i < qseq; i++)
+				memmove(q[(i-1) % qn], q[i % qn], QL);
+			e = q[(qseq-1) % qn];
+			strecpy(e, e+QL, s);
+			qcoalesced++;
+			return 1;
+		}
+	}
+	return 0;
+}
+
 static void
 qpush(char *s)
 {
+	Sub *sub;
 	Req *r;
-	char *p;
-	int n;
-
-	/* if a reader is waiting, respond immediately */
-	if(pend != nil){
-		r = pend;
-		pend = nil;
-		p = s;
-		n = strlen(p);
-		if(n > r->ifcall.count)
-			n = r->ifcall.count;
-		r->ofcall.count = n;
-		memmove(r->ofcall.data, p, n);
-		respond(r, nil);
-		return;
+	uvlong min, max;
+
+	if(lossless){
+		cursors(&min, &max);
+		if(qcoalesce(s, max))
+			return;    /* nobody has read it yet: no wakeups either */
+		while(qseq - min >= qn && qgrow())
+			;
 	}
-
-	strecpy(q[qt], q[qt]+QL, s);
-	qt = (qt+1) % QN;
-	if(qt == qh) /* drop oldest */
-		qh = (qh+1) % QN;
+	strecpy(q[qseq % qn], q[qseq % qn]+QL, s);
+	qseq++;
+
+	/* every subscriber with a read waiting gets it now */
+	for(sub=subs; sub != nil; sub=sub->link)
+		while((r = sub->pend) != nil && fillread(sub, r)){
+			sub->pend = r->aux;
+			r->aux = nil;
+			respond(r, nil);
+		}
 }
 
 void
@@ -78,13 +264,168 @@ srv9ppostevent(char *fmt, ...)
 		return;
 	if(buf[strlen(buf)-1] != '\n')
 		strecpy(buf+strlen(buf), buf+sizeof buf, "\n");
+	qlock(&lk);
 	qpush(buf);
+	qunlock(&lk);
+}
+
+/* replace a state file's bytes; caller holds lk. 1 if they changed */
+static int
+setfile(File *f, char *s)
+{
+	char *n;
+
+	if(f == nil || strcmp(f->aux, s) == 0)
+		return 0;
+	n = strdup(s);
+	if(n == nil)
+		return 0;
+	free(f->aux);
+	f->aux = n;
+	f->length = strlen(n);
+	f->qid.vers++;
+	return 1;
+}
+
+static File*
+statefile(File *dir, char *name, char *s)
+{
+	char *n;
+	File *f;
+
+	n = strdup(s);
+	if(n == nil)
+		sysfatal("srv9p: %r");
+	f = createfile(dir, name, nil, 0444, n);
+	if(f == nil)
+		sysfatal("srv9p: create %s: %r", name);
+	f->length = strlen(n);
+	return f;
+}
+
+static void
+freefile(File *f)
+{
+	free(f->aux);
+	f->aux = nil;
+}
+
+/* preset or panel moved: their files and status; caller holds lk */
+static void
+setknobs(void)
+{
+	char buf[64];
+
+	snprint(buf, sizeof buf, "%s\n", preset);
+	setfile(presetf, buf);
+	snprint(buf, sizeof buf, "%s\n", panel);
+	setfile(panelf, buf);
+	snprint(buf, sizeof buf, "preset %s\npanel %s\n", preset, panel);
+	setfile(statusf, buf);
+}
+
+/* state/windows from the list; both are sorted by id, so one merge pass */
+static void
+syncwins(char *s)
+{
+	File **nw, *f;
+	char *ln, *e, *p, *x, buf[QL], name[16];
+	int i, n, id;
+
+	for(n=0, p=s; (p = strchr(p, '\n')) != nil; p++)
+		n++;
+	nw = malloc((n+1) * sizeof nw[0]);
+	if(nw == nil)
+		return;
+	i = n = 0;
+	for(ln=s; *ln; ln=e){
+		if((e = strchr(ln, '\n')) != nil)
+			e++;
+		else
+			e = ln + strlen(ln);
+		id = strtol(ln, &p, 10);
+		if(id <= 0 || *p++ != ' ')
+			continue;
+		while(i < nwf && atoi(wf[i]->name) < id)
+			removefile(wf[i++]);
+		if(i < nwf && atoi(wf[i]->name) == id)
+			f = wf[i++];
+		else{
+			snprint(name, sizeof name, "%d", id);
+			if((x = strdup("")) == nil)
+				continue;
+			if((f = createfile(windir, name, nil, 0444, x)) == nil){
+				free(x);
+				continue;
+			}
+		}
+		snprint(buf, sizeof buf, "%.*s", (int)(e-p), p);
+		setfile(f, buf);
+		nw[n++] = f;
+	}
+	while(i < nwf)
+		removefile(wf[i++]);
+	free(wf);
+	wf = nw;
+	nwf = n;
+}
+
+/* replace the windows list; only the files that changed bump qid.vers */
+void
+srv9psetwindows(char *s)
+{
+	qlock(&lk);
+	if(winsf != nil){
+		setfile(winsf, s);
+		syncwins(s);
+	}
+	qunlock(&lk);
+}
+
+static int
+themeok(int i, char *v)
+{
+	char *e;
+	long n;
+
+	if(theme[i].type == ThemeRGB){
+		if(*v == '#')
+			v++;
+		if(strlen(v) != 6)
+			return 0;
+		strtoul(v, &e, 16);
+		return *e == 0;
+	}
+	n = strtol(v, &e, 10);
+	return e != v && *e == 0 && n >= theme[i].min && n <= theme[i].max;
+}
+
+/* 0 ok, -1 unknown key, -2 bad value; "" clears the override */
+int
+srv9psettheme(char *key, char *val)
+{
+	char buf[32];
+	int i;
+
+	for(i=0; i<nelem(theme); i++)
+		if(strcmp(theme[i].key, key) == 0)
+			break;
+	if(i == nelem(theme))
+		return -1;
+	if(*val && !themeok(i, val))
+		return -2;
+	qlock(&lk);
+	strecpy(theme[i].val, theme[i].val+sizeof theme[i].val, val);
+	snprint(buf, sizeof buf, "%s%s", val, *val ? "\n" : "");
+	setfile(theme[i].f, buf);
+	qunlock(&lk);
+	return 0;
 }
 
 static void
 ctlwrite(Req *r)
 {
-	char *s, *a;
+	char *s, *a, *v;
 	char buf[256];
 
 	/* copy and NUL-terminate */
@@ -109,7 +450,10 @@ ctlwrite(Req *r)
 		if(a==nil){
 			srv9ppostevent("err setpreset missing");
 		}else if(strcmp(a,"terminal")==0 || strcmp(a,"dark")==0 || strcmp(a,"glass")==0){
+			qlock(&lk);
 			strecpy(preset, preset+sizeof preset, a);
+			setknobs();
+			qunlock(&lk);
 			srv9ppostevent("ok setpreset %s", preset);
 		}else{
 			srv9ppostevent("err setpreset badvalue");
@@ -118,11 +462,37 @@ ctlwrite(Req *r)
 		if(a==nil){
 			srv9ppostevent("err panel missing");
 		}else if(strcmp(a,"top")==0 || strcmp(a,"bottom")==0 || strcmp(a,"left")==0){
+			qlock(&lk);
 			strecpy(panel, panel+sizeof panel, a);
+			setknobs();
+			qunlock(&lk);
 			srv9ppostevent("ok panel %s", panel);
 		}else{
 			srv9ppostevent("err panel badvalue");
 		}
+	}else if(strcmp(s, "theme")==0){
+		/* theme key [value]: no value clears the override */
+		v = nil;
+		if(a != nil && (v = strchr(a, ' ')) != nil){
+			*v++ = 0;
+			while(*v==' ' || *v=='\t') v++;
+		}
+		if(a==nil || *a==0){
+			srv9ppostevent("err theme missing");
+		}else switch(srv9psettheme(a, v ? v : "")){
+		case 0:
+			if(v != nil && *v)
+				srv9ppostevent("ok theme %s %s", a, v);
+			else
+				srv9ppostevent("ok theme %s", a);
+			break;
+		case -1:
+			srv9ppostevent("err theme badkey");
+			break;
+		default:
+			srv9ppostevent("err theme badvalue");
+			break;
+		}
 	}else{
 		srv9ppostevent("err unknown");
 	}
@@ -131,53 +501,118 @@ ctlwrite(Req *r)
 	respond(r, nil);
 }
 
+/* status, windows and state/...: a copy of the cached bytes */
 static void
-statusread(Req *r)
+stateread(Req *r)
 {
-	char buf[256];
-	int n;
-
-	n = snprint(buf, sizeof buf, "preset %s\npanel %s\n", preset, panel);
-
-	readstr(r, buf);
+	qlock(&lk);
+	readstr(r, r->fid->file->aux);
+	qunlock(&lk);
 	respond(r, nil);
 }
 
 static void
 eventsread(Req *r)
 {
-	char *s;
-	int n;
+	Sub *sub;
 
-	/* treat as stream: only offset 0 is meaningful */
-	if(r->ifcall.offset != 0){
+	if(r->ifcall.count == 0){
 		r->ofcall.count = 0;
 		respond(r, nil);
 		return;
 	}
-
-	if(qh == qt){
-		/* nothing available: hold request */
-		pend = r;
+	qlock(&lk);
+	sub = r->fid->aux;
+	if(sub->pend != nil || !fillread(sub, r)){
+		/* nothing new (or older reads waiting): queue behind them */
+		r->aux = nil;
+		if(sub->pend == nil)
+			sub->pend = r;
+		else
+			sub->pendt->aux = r;
+		sub->pendt = r;
+		qunlock(&lk);
 		return;
 	}
+	qunlock(&lk);
+	respond(r, nil);
+}
 
-	s = q[qh];
-	qh = (qh+1) % QN;
+static void
+fsopen(Req *r)
+{
+	Sub *sub;
 
-	n = strlen(s);
-	if(n > r->ifcall.count)
-		n = r->ifcall.count;
-	r->ofcall.count = n;
-	memmove(r->ofcall.data, s, n);
+	if(strcmp(r->fid->file->name, "events") == 0){
+		sub = mallocz(sizeof *sub, 1);
+		if(sub == nil){
+			respond(r, "out of memory");
+			return;
+		}
+		qlock(&lk);
+		sub->next = qseq;
+		sub->link = subs;
+		subs = sub;
+		qunlock(&lk);
+		r->fid->aux = sub;
+	}
 	respond(r, nil);
 }
 
+/* a flushed read leaves its fid's queue */
+static void
+fsflush(Req *r)
+{
+	Req *o, *x, *prev;
+	Sub *sub;
+
+	o = r->oldreq;
+	qlock(&lk);
+	for(sub=subs; sub != nil; sub=sub->link){
+		prev = nil;
+		for(x=sub->pend; x != nil && x != o; x=x->aux)
+			prev = x;
+		if(x == nil)
+			continue;
+		if(prev == nil)
+			sub->pend = o->aux;
+		else
+			prev->aux = o->aux;
+		if(sub->pendt == o)
+			sub->pendt = prev;
+		o->aux = nil;
+		qunlock(&lk);
+		respond(o, "interrupted");
+		respond(r, nil);
+		return;
+	}
+	qunlock(&lk);
+	respond(r, nil);
+}
+
+static void
+fsdestroyfid(Fid *f)
+{
+	Sub **l, *sub;
+
+	if((sub = f->aux) == nil)    /* only events fids have one */
+		return;
+	qlock(&lk);
+	for(l=&subs; *l != nil; l=&(*l)->link)
+		if(*l == sub){
+			*l = sub->link;
+			break;
+		}
+	qunlock(&lk);
+	free(sub);
+	f->aux = nil;
+}
+
 static void
 fsread(Req *r)
 {
-	if(strcmp(r->fid->file->name, "status")==0)
-		statusread(r);
+	if(r->fid->file->aux != nil)
+		stateread(r);
 	else if(strcmp(r->fid->file->name, "events")==0)
 		eventsread(r);
 	else
@@ -194,15 +629,43 @@ fswrite(Req *r)
 }
 
 void
-srv9pstart(void)
+srv9pstart(int ring, int ll)
 {
+	File *st;
+	char buf[32];
+	int i;
+
+	qn = ring;
+	qmax = ring*QGrow;
+	lossless = ll;
+	q = malloc(qn * sizeof q[0]);
+	if(q == nil)
+		sysfatal("srv9p: %r");
+
+	fs.open = fsopen;
 	fs.read = fsread;
 	fs.write = fswrite;
+	fs.flush = fsflush;
+	fs.destroyfid = fsdestroyfid;
 
-	t = alloctree(nil, nil, DMDIR|0555, nil);
+	t = alloctree(nil, nil, DMDIR|0555, freefile);
 	createfile(t->root, "ctl", nil, 0666, nil);
-	createfile(t->root, "status", nil, 0444, nil);
+	statusf = statefile(t->root, "status", "");
 	createfile(t->root, "events", nil, 0444, nil);
+	winsf = statefile(t->root, "windows", "");
+	if((st = createfile(t->root, "state", nil, DMDIR|0555, nil)) == nil)
+		sysfatal("srv9p: create state: %r");
+	presetf = statefile(st, "preset", "");
+	panelf = statefile(st, "panel", "");
+	if((themedir = createfile(st, "theme", nil, DMDIR|0555, nil)) == nil)
+		sysfatal("srv9p: create theme: %r");
+	for(i=0; i<nelem(theme); i++){
+		snprint(buf, sizeof buf, "%s%s", theme[i].val, theme[i].val[0] ? "\n" : "");
+		theme[i].f = statefile(themedir, theme[i].key, buf);
+	}
+	if((windir = createfile(st, "windows", nil, DMDIR|0555, nil)) == nil)
+		sysfatal("srv9p: create windows: %r");
+	setknobs();
 	fs.tree = t;
 
 	/* post at /srv/9de; do not auto-mount (Settings/Dash can mount) */
@@ -2,8 +2,10 @@
 #define _9DE_SRV9P_H_
 
 /* minimal shell control plane */
-void srv9pstart(void);
+void srv9pstart(int ring, int lossless);   /* events kept in the one shared ring; coalesce state */
 void srv9ppostevent(char *fmt, ...);
+void srv9psetwindows(char *s);    /* whole windows file; state/windows follows it */
+int  srv9psettheme(char *key, char *val);   /* state/theme/<key>; -1 bad key, -2 bad value */
 
 /* current state knobs */
 char* srv9preset(void);
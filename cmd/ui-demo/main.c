@@ -29,6 +29,7 @@ static int segsel   = 0;
 static Rune textbuf[128];
 static int  textn;
 static int  focused;
+static char applied[128];   /* last Apply, shown in the output box */
 
 /* layout rects */
 static Rectangle rnav, rmain, rhead, rcontent;
@@ -42,6 +43,9 @@ static Rectangle rseg[3];
 static Rectangle rpreview;
 static Rectangle rout;
 
+/* ids for the interactive widgets, hashed once */
+static ulong idreset, idapply;
+
 static int
 clampi(int v, int lo, int hi)
 {
@@ -179,6 +183,7 @@ redraw(void)
 	char buf[128];
 
 	layout();
+	ui9_begin(&ui, screen);
 
 	/* window background */
 	draw(screen, screen->r, ui9img(&ui, Ui9CBg), nil, ZP);
@@ -215,15 +220,23 @@ redraw(void)
 		string(screen, Pt(rhead.min.x+14, rhead.min.y + (Dy(rhead)-f->height)/2),
 		       ui9img(&ui, Ui9CText), ZP, f, "ui9demo");
 
-		/* right actions (visual only for now) */
+		/* right actions: immediate-mode buttons (state lives in ui) */
 		{
-			char *a1="Reset", *a2="Apply";
-			int w2 = stringwidth(f, a2);
-			int w1 = stringwidth(f, a1);
-			Point p2 = Pt(rhead.max.x-14-w2, rhead.min.y + (Dy(rhead)-f->height)/2);
-			Point p1 = Pt(p2.x-18-w1, p2.y);
-			string(screen, p1, ui9img(&ui, Ui9CMuted), ZP, f, a1);
-			string(screen, p2, ui9img(&ui, Ui9CText), ZP, f, a2);
+			int bw = 72, bh = 26;
+			Rectangle b2 = Rect(rhead.max.x-14-bw, rhead.min.y + (Dy(rhead)-bh)/2, rhead.max.x-14, rhead.min.y + (Dy(rhead)+bh)/2);
+			Rectangle b1 = rectaddpt(b2, Pt(-bw-10, 0));
+
+			if(ui9_button(&ui, idreset, b1, "Reset", Ui9Secondary)){
+				chkpanel = chkdemo = 1;
+				alpha_v = 180;
+				segsel = 0;
+				textn = 0;
+				textbuf[0] = 0;
+				applied[0] = 0;
+			}
+			if(ui9_button(&ui, idapply, b2, "Apply", Ui9Primary))
+				snprint(applied, sizeof applied, "applied: start_panel=%d start_demo=%d ui_alpha=%d seg=%d",
+					chkpanel, chkdemo, alpha_v, segsel);
 		}
 	}
 
@@ -266,6 +279,8 @@ redraw(void)
 
 		snprint(buf, sizeof buf, "start_panel=%d start_demo=%d seg=%d focused=%d", chkpanel, chkdemo, segsel, focused);
 		string(screen, Pt(box.min.x+10, box.min.y+46), ui9img(&ui, Ui9CMuted), ZP, f, buf);
+		if(applied[0])
+			string(screen, Pt(box.min.x+10, box.min.y+64), ui9img(&ui, Ui9CAccent), ZP, f, applied);
 
 		string(screen, Pt(box.min.x+10, box.max.y-22), ui9img(&ui, Ui9CMuted), ZP, f, "tip: press 'q' to quit");
 	}
@@ -286,6 +301,11 @@ onmouse(Mouse m)
 {
 	static int ob;
 	static int dragging;
+	int released;
+
+	/* header buttons read this snapshot on the next redraw */
+	ui9_input(&ui, &m, 0);
+	released = !(m.buttons & 1) && (ob & 1);
 
 	if(m.buttons & 1){
 		/* drag slider */
@@ -299,8 +319,11 @@ onmouse(Mouse m)
 		dragging = 0;
 	}
 
-	if(!pressed(m, &ob))
+	if(!pressed(m, &ob)){
+		if(released)
+			redraw();   /* completes a button click */
 		return;
+	}
 
 	/* nav select */
 	{
@@ -395,6 +418,8 @@ main(int argc, char **argv)
 	ui9init(&ui, display, font);
 	ui9applyenv(&ui);
 	ui9setdst(&ui, screen);
+	idreset = ui9_idstr("demo.reset");
+	idapply = ui9_idstr("demo.apply");
 
 	einit(Emouse|Ekeyboard);
 
@@ -9,5 +9,8 @@
 #include <9deui/layout.h>
 #include <9deui/icon.h>
 #include <9deui/frame.h>
+#include <9deui/wsys.h>
+#include <9deui/cfg.h>
+#include <9deui/font.h>
 
 #endif
@@ -0,0 +1,54 @@
+#ifndef _9DEUI_CFG_H_
+#define _9DEUI_CFG_H_
+
+/*
+ * cfg.h — shared config.rc reader.
+ *
+ * Each app registers its keys once (name, type, default, int range)
+ * and loads them in layers, later layers winning:
+ *
+ *   registered defaults < $home/lib/9de/defaults.rc
+ *                       < $home/lib/9de/config.rc < environment
+ *
+ * Files are parsed in one pass into a hashed table (unregistered keys
+ * are kept too, as strings); the environment is consulted for
+ * registered keys only. Values are normalized the way rc would see
+ * them: trimmed, one level of quotes stripped, "(a b)" -> "a b". A '#'
+ * starts a comment only at the start of a word outside quotes, so
+ * ui_accent=#4c8dff works.
+ */
+
+typedef struct Ui9Cfg Ui9Cfg;
+typedef struct Ui9CfgKey Ui9CfgKey;
+
+enum {
+	Ui9CfgStr = 0,
+	Ui9CfgInt,
+	Ui9CfgBool,
+
+	/* layers, from ui9cfg_layer */
+	Ui9CfgDefault = 0,
+	Ui9CfgFile,
+	Ui9CfgEnv,
+};
+
+struct Ui9CfgKey {
+	char *name;
+	int type;
+	char *def;          /* as text; nil: unset */
+	int min, max;       /* ints are clamped when min < max */
+};
+
+Ui9Cfg* ui9cfg_new(Ui9CfgKey *keys, int nkeys);   /* defaults layer only */
+int     ui9cfg_file(Ui9Cfg *c, char *path);       /* -1 if unreadable */
+void    ui9cfg_env(Ui9Cfg *c);
+Ui9Cfg* ui9cfg_load(Ui9CfgKey *keys, int nkeys, int env);  /* new + defaults.rc + config.rc [+ env] */
+
+char*   ui9cfg_str(Ui9Cfg *c, char *key);         /* nil if unset */
+void    ui9cfg_strcpy(Ui9Cfg *c, char *key, char *dst, int n);   /* leaves dst if unset */
+int     ui9cfg_int(Ui9Cfg *c, char *key);
+int     ui9cfg_bool(Ui9Cfg *c, char *key);
+int     ui9cfg_layer(Ui9Cfg *c, char *key);       /* -1 if unset */
+void    ui9cfg_free(Ui9Cfg *c);
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef _9DEUI_FONT_H_
+#define _9DEUI_FONT_H_
+
+/*
+ * font.h — process-wide font cache keyed by (display, path).
+ *
+ * ui9font_open returns a shared, refcounted Font: the first open reads
+ * the font file and preloads the subfonts for printable ASCII, later
+ * opens of the same path are a list walk. Release with ui9font_put,
+ * never freefont; the font is freed with its last reference.
+ * ui9font_preload pulls in the subfonts for any other runes an app
+ * draws (symbols, ellipses) so the first frame does no font I/O.
+ */
+
+Font*  ui9font_open(Display *d, char *path);     /* nil + %r on failure */
+void   ui9font_put(Font *f);                     /* nil and uncached fonts are ignored */
+void   ui9font_preload(Font *f, char *s);
+void   ui9font_stats(ulong *opens, ulong *hits, int *live);
+
+#endif
@@ -14,13 +14,65 @@ enum {
 	UI9_ABI = 1,
 };
 
-/* stable widget id helpers */
+/* stable widget id helpers; hash names once, not per frame */
 ulong ui9_idstr(char *s);
 ulong ui9_idptr(void *p);
+ulong ui9_idmix(ulong id, ulong n);   /* child n of id (list rows etc.) */
 
 /* input snapshots (optional, used by widgets) */
 void  ui9_input(Ui9 *ui, Mouse *m, Rune k);
 
+/*
+ * Event batches (libevent apps): ui9_drain empties the queue once per
+ * frame. A mouse event with the same buttons as the one before it is
+ * motion and folds into a directly preceding motion entry; button
+ * transitions keep their own entry and position, and keys stay, in
+ * order. Handle the batch, then draw once.
+ *
+ * Keys in ev->datakeys (estart sources, e.g. a helper proc's pipe) are
+ * kept as Ui9EvData entries in order; their bytes are copied into the
+ * batch, so they stay valid until the next ui9_drain.
+ */
+enum {
+	Ui9EvMouse = 0,
+	Ui9EvKey,
+	Ui9EvData,
+	Ui9MaxEv = 64,     /* per batch; the rest stays queued for the next */
+	Ui9EvBuf = 64*1024,   /* data bytes per batch (>= a few EMAXMSG) */
+};
+
+typedef struct Ui9Ev Ui9Ev;
+typedef struct Ui9Events Ui9Events;
+
+struct Ui9Ev {
+	int type;
+	Mouse m;
+	int motion;        /* Ui9EvMouse: buttons unchanged from the event before */
+	Rune k;
+	ulong key;         /* Ui9EvData: estart key, bytes in data[0..n) */
+	char *data;
+	int n;
+};
+
+struct Ui9Events {
+	Ui9Ev e[Ui9MaxEv];
+	int n;
+	int resized;       /* Eresize seen in this batch */
+	int nread;         /* events taken off the queue this batch */
+	int nmerged;       /* ... of which folded into a later motion */
+	ulong datakeys;    /* set by the caller: estart keys kept as Ui9EvData */
+	char buf[Ui9EvBuf];
+	int nbuf;
+	int mb;            /* buttons of the last mouse event read */
+
+	/* since the struct was zeroed */
+	ulong batches;
+	ulong read;
+	ulong merged;
+};
+
+int   ui9_drain(Ui9Events *ev, ulong keys, int wait);  /* wait: block for the first event */
+
 /* focus/capture */
 ulong ui9_focus(Ui9 *ui);
 void  ui9_setfocus(Ui9 *ui, ulong id);
@@ -31,6 +83,46 @@ void  ui9_setcapture(Ui9 *ui, ulong id);
 int   ui9_iscapture(Ui9 *ui, ulong id);
 void  ui9_releasecapture(Ui9 *ui);
 
+/*
+ * Hit-testing: register each interactive rect with its id while
+ * drawing; ui9_hit then answers from a grid without re-running layout.
+ * ui9_begin clears the index (bounds = dst->r); call ui9_hitreset after
+ * it when drawing into an offscreen buffer in screen coordinates.
+ * Lookups between frames see the last frame's rects.
+ */
+typedef struct Ui9Hits Ui9Hits;
+
+void  ui9_hitreset(Ui9 *ui, Rectangle bounds);
+void  ui9_hitadd(Ui9 *ui, Rectangle r, ulong id);   /* later adds are on top */
+ulong ui9_hit(Ui9 *ui, Point pt);                   /* topmost id, 0 if none */
+int   ui9_hitrect(Ui9 *ui, ulong id, Rectangle *r);
+void  ui9_hitfree(Ui9 *ui);
+
+/*
+ * Widget state, keyed by id (lib/state.c). Entries are created on first
+ * ui9_state and dropped by ui9_begin when a frame went by without
+ * them. Lookups are O(1) and allocate only when the table grows.
+ */
+typedef struct Ui9State Ui9State;
+typedef struct Ui9States Ui9States;
+
+struct Ui9State {
+	ulong id;
+	int hot;           /* pointer over r (and nothing else has capture) */
+	int active;        /* pressed over r, waiting for the release */
+	int t;             /* animation 0..255, see ui9_animate */
+	Rectangle r;       /* last rect */
+	ulong frame;       /* last frame it was used */
+	int down;          /* button 1 as of the last use, -1 before the first */
+};
+
+Ui9State* ui9_state(Ui9 *ui, ulong id);
+int   ui9_clickable(Ui9 *ui, ulong id, Rectangle r, Ui9State **sp);  /* 1: clicked */
+int   ui9_animate(Ui9 *ui, Ui9State *s, int target);  /* steps s->t, returns it */
+int   ui9_animating(Ui9 *ui);       /* some widget wants another frame */
+void  ui9_statebegin(Ui9 *ui);      /* ui9_begin calls this */
+void  ui9_statefree(Ui9 *ui);
+
 /* optional frame begin/end */
 void  ui9_begin(Ui9 *ui, Image *dst);
 void  ui9_end(Ui9 *ui);
@@ -11,10 +11,125 @@
  *   /lib/9de/icons/acme/icon.bit
  *
  * Paths can also be absolute, in which case they are loaded directly.
+ *
+ * Cache:
+ *   ui9icon_find/ui9icon_any go through a per-Ui9 cache keyed by
+ *   (app, size). The returned Image is shared and refcounted: release it
+ *   with ui9icon_put, never freeimage. Misses are remembered for
+ *   negttl ms so repeated lookups of missing icons cost no syscalls.
+ *   Unreferenced entries are evicted LRU-first once the cached pixel
+ *   total exceeds maxpixels.
+ *
+ * Pack:
+ *   9de-iconpack compiles an icon tree into one file,
+ *     $home/lib/9de/icons/icons.pack  (or /lib/9de/icons/icons.pack)
+ *   laid out as
+ *     "9deiconpack %11d\n"             24-byte header, index length
+ *     "app size minx miny maxx maxy\n"  one index line per icon
+ *     compressed image                  the atlas, as writeimage(2)
+ *   The cache loads it once into a single atlas Image, before any file
+ *   lookup. ui9icon_findr/ui9icon_draw hand out sub-rectangles of the
+ *   atlas; find, any, find_async and scaled copy an icon out of it on a
+ *   miss (an allocimage and a draw, no file I/O). Icons missing from the
+ *   pack fall back to the index and file search.
+ *
+ * Scaled:
+ *   ui9icon_scaled returns the icon with its longest side at size. A
+ *   missing size is resampled from the nearest larger source (integer
+ *   box where the ratio allows, bilinear otherwise), kept in memory and
+ *   written to $home/lib/9de/icons/cache/<app>/<size>.bit so the next
+ *   launch loads it directly. <size>.src stamps the source file (path,
+ *   qid, mtime, length); a cached image whose source has changed or
+ *   gone is resampled again.
+ *
+ * Index:
+ *   9de-iconindex walks both roots once and writes a sorted binary index
+ *   of (app, size, root, path, offset) to $home/lib/9de/icons/index.
+ *   The cache loads it on first use and binary-searches it, so lookups
+ *   resolve with no probing; a miss costs no syscall at all. The index
+ *   is trusted while each root's qid.vers matches the one recorded in
+ *   it; otherwise the roots are rescanned in memory and the file is
+ *   rewritten. Adding a size to an app that is already indexed does
+ *   not touch the root: re-run 9de-iconindex (or ui9icon_flush).
+ *
+ * Async:
+ *   ui9icon_find_async returns a cached image, or a themed placeholder
+ *   while a worker proc reads and parses the file. Requests for the same
+ *   (app, size) in flight are merged. The UI proc finishes the job in
+ *   ui9icon_poll (allocimage + loadimage, never on the worker) and calls
+ *   each waiter's cb with the rect it passed, so it can redraw just that.
+ *   Call ui9icon_poll from the event loop, or estart(3) on
+ *   ui9icon_asyncfd to get woken when a decode completes. Placeholders
+ *   are kept for the cache's life (repainted by ui9icon_flush) and exist
+ *   for the first few sizes asked; other sizes get nil until the decode.
  */
 
-Image* ui9icon_load(Ui9 *ui, char *path);           /* absolute/relative path */
-Image* ui9icon_find(Ui9 *ui, char *app, int size);  /* app name */
-Image* ui9icon_any(Ui9 *ui, char *app);             /* best-effort: tries common sizes */
+#define UI9ICONPACK "9deiconpack"
+
+typedef struct Ui9IconStats Ui9IconStats;
+typedef void (*Ui9IconFn)(Ui9 *ui, Rectangle r, void *arg);
+typedef struct Ui9IconCache Ui9IconCache;
+typedef struct Ui9IconIndex Ui9IconIndex;
+
+enum {
+	Ui9IconPackHdr   = 24,         /* strlen(UI9ICONPACK) + 1 + 11 + 1 */
+	Ui9IconMaxPixels = 512*1024,   /* default cap: ~2MB at 32bpp */
+	Ui9IconNegTTL    = 5000,       /* default negative entry lifetime (ms) */
+};
+
+struct Ui9IconStats {
+	ulong hits;        /* answered from a cached image */
+	ulong neghits;     /* answered from a negative entry */
+	ulong misses;      /* went to the filesystem */
+	ulong evictions;
+	int   nentries;    /* positive entries */
+	int   nneg;        /* negative entries (expired ones are pruned lazily) */
+	int   nref;        /* entries currently referenced */
+	vlong pixels;      /* cached pixels */
+	vlong bytes;       /* cached image bytes (by depth) */
+	vlong maxpixels;
+	int   npack;       /* icons in the loaded pack, 0 if none */
+	ulong packed;      /* cache misses served by copying out of the atlas */
+	int   nindex;      /* entries in the directory index, 0 if none */
+	ulong rescans;     /* index rebuilt because a root changed */
+	ulong scaled;      /* resamples done (disk cache misses) */
+	ulong async;       /* async requests answered with a placeholder */
+	ulong merged;      /* ... of which joined a decode already in flight */
+	int   inflight;    /* queued or decoding jobs */
+};
+
+Image* ui9icon_load(Ui9 *ui, char *path);           /* absolute/relative path; caller owns */
+Image* ui9icon_find(Ui9 *ui, char *app, int size);  /* app name; cached, release with ui9icon_put */
+Image* ui9icon_any(Ui9 *ui, char *app);             /* first shipped size found, for callers with no slot size; cached */
+
+/* pack-aware lookup: image (possibly the shared atlas) + the icon's rect in it */
+Image* ui9icon_findr(Ui9 *ui, char *app, int size, Rectangle *r);
+int    ui9icon_draw(Ui9 *ui, Point p, char *app, int size);  /* 1 if drawn */
+
+/* exact size: shipped, disk-cached or resampled; release with ui9icon_put */
+Image* ui9icon_scaled(Ui9 *ui, char *app, int size);
+
+/* 32bpp pixel rows sw x sh -> dw x dh; returns -1 on bad sizes or no memory */
+int    ui9icon_resample(uchar *src, int sw, int sh, uchar *dst, int dw, int dh);
+
+/* async: cached image (ref taken) or a placeholder (no ref); cb fires after the decode, found or not */
+Image* ui9icon_find_async(Ui9 *ui, char *app, int size, Rectangle r, Ui9IconFn cb, void *arg);
+int    ui9icon_poll(Ui9 *ui);                       /* upload finished decodes; returns count */
+int    ui9icon_asyncfd(Ui9 *ui);                    /* readable after a decode finishes */
+
+/* directory index (9de-iconindex); lookup returns the path search order picks */
+Ui9IconIndex* ui9icon_indexscan(void);
+Ui9IconIndex* ui9icon_indexread(char *path);
+int    ui9icon_indexwrite(Ui9IconIndex *x, char *path);
+int    ui9icon_indexfresh(Ui9IconIndex *x);         /* roots' qid.vers unchanged */
+char*  ui9icon_indexlookup(Ui9IconIndex *x, char *app, int size, long *off);
+int    ui9icon_indexlen(Ui9IconIndex *x);
+void   ui9icon_indexfree(Ui9IconIndex *x);
+
+void   ui9icon_put(Ui9 *ui, Image *img);            /* drop a reference from find/any/findr */
+void   ui9icon_limits(Ui9 *ui, vlong maxpixels, long negttlms);  /* <=0 keeps current */
+void   ui9icon_flush(Ui9 *ui);                      /* drop unreferenced + negative entries */
+void   ui9icon_stats(Ui9 *ui, Ui9IconStats *st);
+void   ui9icon_free(Ui9 *ui);                       /* drop everything (ui9free calls this) */
 
 #endif
@@ -37,6 +37,17 @@ enum {
 	Ui9CCount,
 };
 
+/*
+ * Token classes, computed when the theme images are built.
+ * Opaque tokens are allocated RGB24 so devdraw takes the plain fill path;
+ * invisible tokens (alpha 0) make prims skip the pass entirely.
+ */
+enum {
+	Ui9Opaque = 0,
+	Ui9Translucent,
+	Ui9Invisible,
+};
+
 enum {
 	Ui9StyleTerminal = 0,   /* default: terminal-chic */
 	Ui9StyleDark     = 1,   /* dark preset */
@@ -77,6 +88,11 @@ struct Ui9 {
 
 	/* cached 1x1 theme images by role */
 	Image *img[Ui9CCount];
+	uchar cls[Ui9CCount];   /* Ui9Opaque | Ui9Translucent | Ui9Invisible */
+
+	/* draw ops issued through prims since ui9_begin (stats) */
+	ulong nops;
+
 	/* input snapshot (optional) */
 	Mouse m;
 	Rune  k;
@@ -84,6 +100,15 @@ struct Ui9 {
 	/* focus/capture ids */
 	ulong focusid;
 	ulong captureid;
+
+	/* icon cache (lib/icon.c), allocated on first lookup */
+	struct Ui9IconCache *icons;
+
+	/* per-frame hit-test index (lib/hit.c), allocated on first use */
+	struct Ui9Hits *hits;
+
+	/* widget state store (lib/state.c), allocated on first use */
+	struct Ui9States *states;
 };
 
 /* theme setup */
@@ -120,4 +145,8 @@ void  ui9applyenv(Ui9 *ui);
 /* theme color as 1x1 image */
 Image* ui9img(Ui9 *ui, int role);
 
+/* token class of a role (Ui9Opaque etc); ui9visible is class != Ui9Invisible */
+int   ui9class(Ui9 *ui, int role);
+int   ui9visible(Ui9 *ui, int role);
+
 #endif
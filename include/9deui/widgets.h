@@ -14,9 +14,11 @@ enum {
 
 /* Buttons */
 void ui9_button_draw(Ui9 *ui, Rectangle r, char *label, int kind, int state);
+int  ui9_button(Ui9 *ui, ulong id, Rectangle r, char *label, int kind);  /* 1: clicked */
 
 /* Toggle */
 void ui9_toggle_draw(Ui9 *ui, Rectangle r, char *label, int on);
+int  ui9_toggle(Ui9 *ui, ulong id, Rectangle r, char *label, int *on);  /* 1: changed */
 
 /* Slider (0..255) */
 void ui9_slider_draw(Ui9 *ui, Rectangle r, int value);
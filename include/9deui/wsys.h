@@ -0,0 +1,78 @@
+#ifndef _9DEUI_WSYS_H_
+#define _9DEUI_WSYS_H_
+
+/*
+ * wsys.h — incremental rio window model.
+ *
+ * A Ui9Wsys keeps one entry per /dev/wsys/<id>, sorted by id, and
+ * updates it in place: ui9wsys_update rereads the directory listing
+ * through a held fd, diffs it against the table and fills w->d with
+ * the changes since the last update:
+ *
+ *   Ui9WinAdd    new window (label and current already read)
+ *   Ui9WinDel    window went away (entry is gone from w->win)
+ *   Ui9WinTitle  label changed
+ *   Ui9WinFocus  window became current, id -1 if none is (one per
+ *                update at most)
+ *
+ * Each window's label fd stays open and is reread with pread; when the
+ * server versions its files (qid.vers moves on write) an unchanged
+ * version skips the read. wctl is opened per update: rio allows one
+ * reader at a time and blocks it after the first read, so it cannot be
+ * held.
+ */
+
+typedef struct Ui9Win Ui9Win;
+typedef struct Ui9WinDelta Ui9WinDelta;
+typedef struct Ui9Wsys Ui9Wsys;
+
+enum {
+	Ui9WinAdd,
+	Ui9WinDel,
+	Ui9WinTitle,
+	Ui9WinFocus,
+
+	Ui9WinLabel = 128,
+};
+
+struct Ui9Win {
+	int id;
+	int current;
+	char label[Ui9WinLabel];
+	int labelfd;        /* held open, -1 if it could not be */
+	ulong labelvers;    /* qid.vers at the last label read */
+	int seen;           /* listing generation that last saw it */
+};
+
+struct Ui9WinDelta {
+	int op;             /* Ui9WinAdd ... */
+	int id;
+};
+
+struct Ui9Wsys {
+	char *root;
+	int dirfd;
+	int versioned;      /* server bumps qid.vers: label stat before read */
+
+	Ui9Win *win;        /* sorted by id */
+	int nwin;
+	int awin;
+	int focus;          /* current id, -1 if none */
+
+	Ui9WinDelta *d;     /* deltas from the last update */
+	int nd;
+	int ad;
+
+	int gen;
+	ulong polls;        /* stats */
+	ulong opens;
+	ulong reads;
+	ulong skipped;      /* label reads avoided by qid.vers */
+};
+
+Ui9Wsys* ui9wsys_open(char *root);          /* nil root: /dev/wsys */
+int      ui9wsys_update(Ui9Wsys *w);         /* returns w->nd, -1 if the listing failed */
+Ui9Win*  ui9wsys_find(Ui9Wsys *w, int id);
+void     ui9wsys_close(Ui9Wsys *w);
+
+#endif
@@ -0,0 +1,336 @@
+#include <u.h>
+#include <libc.h>
+#include <draw.h>
+#include "../include/9deui/9deui.h"
+
+/*
+ * Config table (see cfg.h): open addressing on the key hash, grown at
+ * 3/4 full. Entries own their key and value strings.
+ */
+
+typedef struct Ent Ent;
+struct Ent {
+	char *key;
+	char *val;
+	int layer;
+	Ui9CfgKey *reg;     /* registration, nil for file-only keys */
+};
+
+struct Ui9Cfg {
+	Ent *e;
+	int cap;            /* power of two */
+	int n;
+	Ui9CfgKey *keys;
+	int nkeys;
+};
+
+static ulong
+hash(char *s)
+{
+	ulong h;
+
+	h = 2166136261UL;
+	while(*s)
+		h = (h ^ (uchar)*s++) * 16777619UL;
+	return h;
+}
+
+static Ent*
+slot(Ui9Cfg *c, char *key)
+{
+	ulong i;
+
+	for(i=hash(key); ; i++){
+		i &= c->cap-1;
+		if(c->e[i].key == nil || strcmp(c->e[i].key, key) == 0)
+			return &c->e[i];
+	}
+}
+
+static void
+grow(Ui9Cfg *c)
+{
+	Ent *old, *e;
+	int i, ocap;
+
+	old = c->e;
+	ocap = c->cap;
+	c->cap = ocap ? ocap*2 : 64;
+	c->e = mallocz(c->cap * sizeof c->e[0], 1);
+	if(c->e == nil)
+		sysfatal("ui9cfg: %r");
+	for(i=0; i<ocap; i++)
+		if(old[i].key != nil){
+			e = slot(c, old[i].key);
+			*e = old[i];
+		}
+	free(old);
+}
+
+static Ent*
+lookup(Ui9Cfg *c, char *key)
+{
+	Ent *e;
+
+	e = slot(c, key);
+	return e->key != nil ? e : nil;
+}
+
+static void
+put(Ui9Cfg *c, char *key, char *val, int layer)
+{
+	Ent *e;
+
+	if(4*(c->n+1) > 3*c->cap)
+		grow(c);
+	e = slot(c, key);
+	if(e->key == nil){
+		e->key = strdup(key);
+		if(e->key == nil)
+			sysfatal("ui9cfg: %r");
+		c->n++;
+	}else if(layer < e->layer)
+		return;
+	free(e->val);
+	e->val = strdup(val);
+	if(e->val == nil)
+		sysfatal("ui9cfg: %r");
+	e->layer = layer;
+}
+
+static char*
+trim(char *s)
+{
+	char *e;
+
+	while(*s == ' ' || *s == '\t' || *s == '\r')
+		s++;
+	e = s + strlen(s);
+	while(e > s && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\r'))
+		e--;
+	*e = 0;
+	return s;
+}
+
+/* trim, strip one level of quotes, "(a b)" -> "a b" */
+static char*
+normalize(char *v)
+{
+	int n;
+
+	v = trim(v);
+	n = strlen(v);
+	if(n >= 2 && (v[0] == '"' || v[0] == '\'') && v[n-1] == v[0]){
+		v[n-1] = 0;
+		v = trim(v+1);
+	}
+	n = strlen(v);
+	if(n >= 2 && v[0] == '(' && v[n-1] == ')'){
+		v[n-1] = 0;
+		v = trim(v+1);
+	}
+	return v;
+}
+
+/* cut an rc comment: '#' at the start of a word, outside quotes */
+static void
+uncomment(char *s)
+{
+	int q;
+	char *p;
+
+	q = 0;
+	for(p=s; *p; p++){
+		if(q){
+			if(*p == q)
+				q = 0;
+		}else if(*p == '\'' || *p == '"')
+			q = *p;
+		else if(*p == '#' && (p == s || p[-1] == ' ' || p[-1] == '\t')){
+			*p = 0;
+			return;
+		}
+	}
+}
+
+static void
+parse(Ui9Cfg *c, char *buf)
+{
+	char *ln, *next, *eq, *key;
+
+	for(ln=buf; ln != nil && *ln; ln=next){
+		if((next = strchr(ln, '\n')) != nil)
+			*next++ = 0;
+		uncomment(ln);
+		if((eq = strchr(ln, '=')) == nil)
+			continue;
+		*eq = 0;
+		key = trim(ln);
+		if(*key == 0)
+			continue;
+		put(c, key, normalize(eq+1), Ui9CfgFile);
+	}
+}
+
+Ui9Cfg*
+ui9cfg_new(Ui9CfgKey *keys, int nkeys)
+{
+	Ui9Cfg *c;
+	Ent *e;
+	int i;
+
+	c = mallocz(sizeof *c, 1);
+	if(c == nil)
+		sysfatal("ui9cfg: %r");
+	c->keys = keys;
+	c->nkeys = nkeys;
+	grow(c);
+	for(i=0; i<nkeys; i++){
+		put(c, keys[i].name, keys[i].def != nil ? keys[i].def : "", Ui9CfgDefault);
+		e = lookup(c, keys[i].name);
+		e->reg = &keys[i];
+		if(keys[i].def == nil)
+			e->layer = -1;     /* registered but unset */
+	}
+	return c;
+}
+
+int
+ui9cfg_file(Ui9Cfg *c, char *path)
+{
+	char *buf;
+	Dir *d;
+	long len, n, m;
+	int fd;
+
+	fd = open(path, OREAD);
+	if(fd < 0)
+		return -1;
+	d = dirfstat(fd);
+	if(d == nil){
+		close(fd);
+		return -1;
+	}
+	len = d->length;
+	free(d);
+	buf = malloc(len+1);
+	if(buf == nil){
+		close(fd);
+		return -1;
+	}
+	n = 0;
+	while(n < len && (m = read(fd, buf+n, len-n)) > 0)
+		n += m;
+	close(fd);
+	buf[n] = 0;
+	parse(c, buf);
+	free(buf);
+	return 0;
+}
+
+void
+ui9cfg_env(Ui9Cfg *c)
+{
+	char *v;
+	int i;
+
+	for(i=0; i<c->nkeys; i++)
+		if((v = getenv(c->keys[i].name)) != nil){
+			put(c, c->keys[i].name, normalize(v), Ui9CfgEnv);
+			free(v);
+		}
+}
+
+Ui9Cfg*
+ui9cfg_load(Ui9CfgKey *keys, int nkeys, int env)
+{
+	char path[512], *h;
+	Ui9Cfg *c;
+
+	c = ui9cfg_new(keys, nkeys);
+	h = getenv("home");
+	snprint(path, sizeof path, "%s/lib/9de/defaults.rc", h ? h : "/usr/glenda");
+	ui9cfg_file(c, path);
+	snprint(path, sizeof path, "%s/lib/9de/config.rc", h ? h : "/usr/glenda");
+	ui9cfg_file(c, path);
+	free(h);
+	if(env)
+		ui9cfg_env(c);
+	return c;
+}
+
+char*
+ui9cfg_str(Ui9Cfg *c, char *key)
+{
+	Ent *e;
+
+	e = lookup(c, key);
+	if(e == nil || e->layer < 0)
+		return nil;
+	return e->val;
+}
+
+void
+ui9cfg_strcpy(Ui9Cfg *c, char *key, char *dst, int n)
+{
+	char *v;
+
+	if((v = ui9cfg_str(c, key)) != nil)
+		strecpy(dst, dst+n, v);
+}
+
+int
+ui9cfg_int(Ui9Cfg *c, char *key)
+{
+	Ent *e;
+	int v;
+
+	e = lookup(c, key);
+	if(e == nil || e->layer < 0)
+		return 0;
+	v = atoi(e->val);
+	if(e->reg != nil && e->reg->min < e->reg->max){
+		if(v < e->reg->min)
+			v = e->reg->min;
+		if(v > e->reg->max)
+			v = e->reg->max;
+	}
+	return v;
+}
+
+/* 1/0, and the usual words */
+int
+ui9cfg_bool(Ui9Cfg *c, char *key)
+{
+	char *v;
+
+	if((v = ui9cfg_str(c, key)) == nil)
+		return 0;
+	if(cistrcmp(v, "true") == 0 || cistrcmp(v, "yes") == 0 || cistrcmp(v, "on") == 0)
+		return 1;
+	return atoi(v) != 0;
+}
+
+int
+ui9cfg_layer(Ui9Cfg *c, char *key)
+{
+	Ent *e;
+
+	e = lookup(c, key);
+	return e != nil ? e->layer : -1;
+}
+
+void
+ui9cfg_free(Ui9Cfg *c)
+{
+	int i;
+
+	if(c == nil)
+		return;
+	for(i=0; i<c->cap; i++){
+		free(c->e[i].key);
+		free(c->e[i].val);
+	}
+	free(c->e);
+	free(c);
+}
@@ -0,0 +1,97 @@
+#include <u.h>
+#include <libc.h>
+#include <draw.h>
+#include "../include/9deui/9deui.h"
+
+/*
+ * Font cache (see font.h). A handful of fonts per process at most, so
+ * a list is enough.
+ */
+
+typedef struct Fent Fent;
+struct Fent {
+	Display *d;
+	char *path;
+	Font *f;
+	int ref;
+	Fent *next;
+};
+
+static Fent *fonts;
+static ulong nopen, nhit;
+
+static char ascii[] =
+	" !\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`abcdefghijklmnopqrstuvwxyz{|}~";
+
+Font*
+ui9font_open(Display *d, char *path)
+{
+	Fent *e;
+	Font *f;
+
+	for(e=fonts; e != nil; e=e->next)
+		if(e->d == d && strcmp(e->path, path) == 0){
+			e->ref++;
+			nhit++;
+			return e->f;
+		}
+
+	f = openfont(d, path);
+	nopen++;
+	if(f == nil)
+		return nil;
+	e = mallocz(sizeof *e, 1);
+	if(e == nil || (e->path = strdup(path)) == nil)
+		sysfatal("ui9font: %r");
+	e->d = d;
+	e->f = f;
+	e->ref = 1;
+	e->next = fonts;
+	fonts = e;
+	ui9font_preload(f, ascii);
+	return f;
+}
+
+void
+ui9font_put(Font *f)
+{
+	Fent **l, *e;
+
+	if(f == nil)
+		return;
+	for(l=&fonts; (e = *l) != nil; l=&e->next)
+		if(e->f == f){
+			if(--e->ref > 0)
+				return;
+			*l = e->next;
+			freefont(e->f);
+			free(e->path);
+			free(e);
+			return;
+		}
+}
+
+/* stringwidth loads (and caches) every subfont s touches */
+void
+ui9font_preload(Font *f, char *s)
+{
+	if(f != nil && s != nil)
+		stringwidth(f, s);
+}
+
+void
+ui9font_stats(ulong *opens, ulong *hits, int *live)
+{
+	Fent *e;
+	int n;
+
+	n = 0;
+	for(e=fonts; e != nil; e=e->next)
+		n++;
+	if(opens != nil)
+		*opens = nopen;
+	if(hits != nil)
+		*hits = nhit;
+	if(live != nil)
+		*live = n;
+}
@@ -30,6 +30,16 @@ ui9_idptr(void *p)
 	return (ulong)(uintptr)p;
 }
 
+ulong
+ui9_idmix(ulong id, ulong n)
+{
+	uchar b[2*sizeof(ulong)];
+
+	memmove(b, &id, sizeof id);
+	memmove(b+sizeof id, &n, sizeof n);
+	return fnv1a(b, sizeof b);
+}
+
 void
 ui9_input(Ui9 *ui, Mouse *m, Rune k)
 {
@@ -89,6 +99,10 @@ ui9_begin(Ui9 *ui, Image *dst)
 		return;
 	if(dst != nil)
 		ui9setdst(ui, dst);
+	ui->nops = 0;
+	if(ui->hits != nil && ui->dst != nil)
+		ui9_hitreset(ui, ui->dst->r);
+	ui9_statebegin(ui);
 }
 
 void
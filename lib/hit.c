@@ -0,0 +1,158 @@
+#include <u.h>
+#include <libc.h>
+#include <draw.h>
+#include "../include/9deui/9deui.h"
+
+/*
+ * Per-frame hit-test index: a uniform grid over the bounds given to
+ * ui9_begin. Each registered rect is linked into every cell it covers,
+ * newest first, so a lookup walks one short list and the first match
+ * is the topmost (last drawn) rect. Storage is fixed; nothing is
+ * allocated per frame.
+ */
+
+enum {
+	GridW = 32,
+	GridH = 8,
+	MaxHit = 512,       /* rects per frame; later ones are ignored */
+	MaxNode = 4*MaxHit, /* (rect, cell) links */
+};
+
+typedef struct Hit Hit;
+struct Hit {
+	Rectangle r;
+	ulong id;
+};
+
+struct Ui9Hits {
+	Rectangle b;
+	int cw, ch;         /* cell size in pixels */
+	Hit hit[MaxHit];
+	int nhit;
+	short head[GridW*GridH];   /* first node per cell, -1 if none */
+	short node[MaxNode];       /* hit index */
+	short next[MaxNode];
+	int nnode;
+	ulong dropped;
+};
+
+static Ui9Hits*
+hits(Ui9 *ui)
+{
+	if(ui->hits == nil){
+		ui->hits = mallocz(sizeof *ui->hits, 1);
+		if(ui->hits == nil)
+			sysfatal("ui9hit: malloc: %r");
+		ui9_hitreset(ui, ui->dst != nil ? ui->dst->r : Rect(0, 0, GridW, GridH));
+	}
+	return ui->hits;
+}
+
+static int
+clamp(int v, int lo, int hi)
+{
+	return v < lo ? lo : v > hi ? hi : v;
+}
+
+/* cell column/row of a coordinate; outside the bounds maps to the edge */
+static int
+col(Ui9Hits *h, int x)
+{
+	return clamp((x - h->b.min.x) / h->cw, 0, GridW-1);
+}
+
+static int
+row(Ui9Hits *h, int y)
+{
+	return clamp((y - h->b.min.y) / h->ch, 0, GridH-1);
+}
+
+void
+ui9_hitreset(Ui9 *ui, Rectangle bounds)
+{
+	Ui9Hits *h;
+
+	if(ui == nil)
+		return;
+	h = hits(ui);
+	h->b = bounds;
+	h->cw = (Dx(bounds) + GridW-1) / GridW;
+	h->ch = (Dy(bounds) + GridH-1) / GridH;
+	if(h->cw < 1) h->cw = 1;
+	if(h->ch < 1) h->ch = 1;
+	memset(h->head, 0xff, sizeof h->head);
+	h->nhit = 0;
+	h->nnode = 0;
+}
+
+void
+ui9_hitadd(Ui9 *ui, Rectangle r, ulong id)
+{
+	Ui9Hits *h;
+	int x0, x1, y0, y1, x, y, c, i;
+
+	if(ui == nil || id == 0 || Dx(r) <= 0 || Dy(r) <= 0)
+		return;
+	h = hits(ui);
+	x0 = col(h, r.min.x);
+	x1 = col(h, r.max.x-1);
+	y0 = row(h, r.min.y);
+	y1 = row(h, r.max.y-1);
+	if(h->nhit == MaxHit || h->nnode + (x1-x0+1)*(y1-y0+1) > MaxNode){
+		h->dropped++;
+		return;
+	}
+	i = h->nhit++;
+	h->hit[i].r = r;
+	h->hit[i].id = id;
+	for(y=y0; y<=y1; y++)
+		for(x=x0; x<=x1; x++){
+			c = y*GridW + x;
+			h->node[h->nnode] = i;
+			h->next[h->nnode] = h->head[c];
+			h->head[c] = h->nnode++;
+		}
+}
+
+ulong
+ui9_hit(Ui9 *ui, Point pt)
+{
+	Ui9Hits *h;
+	int n;
+
+	if(ui == nil || ui->hits == nil)
+		return 0;
+	h = ui->hits;
+	for(n = h->head[row(h, pt.y)*GridW + col(h, pt.x)]; n >= 0; n = h->next[n])
+		if(ptinrect(pt, h->hit[h->node[n]].r))
+			return h->hit[h->node[n]].id;
+	return 0;
+}
+
+/* rect registered for id this frame (topmost if several) */
+int
+ui9_hitrect(Ui9 *ui, ulong id, Rectangle *r)
+{
+	Ui9Hits *h;
+	int i;
+
+	if(ui == nil || ui->hits == nil || id == 0)
+		return 0;
+	h = ui->hits;
+	for(i=h->nhit-1; i>=0; i--)
+		if(h->hit[i].id == id){
+			if(r != nil)
+				*r = h->hit[i].r;
+			return 1;
+		}
+	return 0;
+}
+
+void
+ui9_hitfree(Ui9 *ui)
+{
+	if(ui == nil)
+		return;
+	free(ui->hits);
+	ui->hits = nil;
+}
@@ -3,8 +3,109 @@
 #include <draw.h>
 #include "../include/9deui/9deui.h"
 
+enum {
+	IconHash = 256,
+	IconMaxNeg = 1024,  /* prune expired negative entries past this */
+	MaxCand = 4,        /* candidate paths per lookup */
+	NPlaceholder = 8,   /* placeholder sizes, fixed once made */
+};
+
+enum {
+	JobQueued = 0,
+	JobBusy,
+	JobDone,
+};
+
+typedef struct Icon Icon;
+typedef struct PackEnt PackEnt;
+typedef struct Job Job;
+typedef struct Waiter Waiter;
+
+struct Icon {
+	char *app;
+	int size;
+	Image *img;         /* nil: negative entry */
+	int ref;
+	vlong pixels;
+	vlong expires;      /* negative entries only (ms) */
+
+	Icon *hnext;
+	Icon *inext;        /* itab chain, entries with an image only */
+	Icon *lprev;        /* LRU list, most recent at head */
+	Icon *lnext;
+};
+
+struct PackEnt {
+	char *app;
+	int size;
+	Rectangle r;        /* in atlas coordinates */
+};
+
+struct Waiter {
+	Rectangle r;
+	Ui9IconFn cb;
+	void *arg;
+	Waiter *next;
+};
+
+/* one async decode; requests for the same key share it */
+struct Job {
+	char *app;
+	int size;
+	int state;          /* Job*; guarded by Ui9IconCache.lk */
+	Waiter *w;
+	Job *next;
+
+	/* filled by the worker */
+	int ok;
+	ulong chan;
+	Rectangle r;
+	int compressed;
+	char *path;         /* from the index; nil: search candidates */
+	long foff;          /* image start in path */
+	uchar *buf;         /* whole file */
+	int off;            /* pixel data start in buf */
+	int n;
+};
+
+struct Ui9IconCache {
+	Icon *tab[IconHash];
+	Icon *itab[IconHash];   /* by Image*, so ui9icon_put is O(1) */
+	Icon *head;
+	Icon *tail;
+
+	/* icons.pack: one atlas image + sorted index */
+	int packtried;
+	char packpath[512];     /* the file the atlas came from */
+	Image *atlas;
+	PackEnt *pack;
+	int npack;
+
+	/* 9de-iconindex: resolved paths, no probing */
+	int idxtried;
+	Ui9IconIndex *idx;
+
+	vlong maxpixels;
+	long negttl;
+	Ui9IconStats st;
+
+	/* async decode: the worker shares this struct (RFMEM) */
+	QLock lk;
+	Rendez work;
+	Job *jobs;
+	int workerpid;
+	int quit;
+	int workerdone;
+	int wantwake;
+	int wakefd[2];
+
+	Image *ph[NPlaceholder];
+	int phsize[NPlaceholder];
+	int nph;
+};
+
 static Image*
-loadimg(Ui9 *ui, char *path)
+loadimgat(Ui9 *ui, char *path, long off)
 {
 	int fd;
 	Image *img;
@@ -15,11 +116,21 @@ loadimg(Ui9 *ui, char *path)
 	fd = open(path, OREAD);
 	if(fd < 0)
 		return nil;
+	if(off > 0 && seek(fd, off, 0) != off){
+		close(fd);
+		return nil;
+	}
 	img = readimage(ui->d, fd, 0);
 	close(fd);
 	return img;
 }
 
+static Image*
+loadimg(Ui9 *ui, char *path)
+{
+	return loadimgat(ui, path, 0);
+}
+
 Image*
 ui9icon_load(Ui9 *ui, char *path)
 {
@@ -35,49 +146,974 @@ home(void)
 	return h;
 }
 
+static int
+isabspath(char *app)
+{
+	return app[0] == '/' || (app[0]=='.' && (app[1]=='/' || (app[1]=='.' && app[2]=='/')));
+}
+
+/* search order from icon.h; returns the number of candidate paths */
+static int
+candidates(char *app, int size, char p[MaxCand][512])
+{
+	char *base[2], hb[256], *h;
+	int i, n, nb;
+
+	if(isabspath(app)){
+		snprint(p[0], sizeof p[0], "%s", app);
+		return 1;
+	}
+
+	nb = 0;
+	h = home();
+	if(h != nil){
+		snprint(hb, sizeof hb, "%s/lib/9de/icons", h);
+		base[nb++] = hb;
+	}
+	base[nb++] = "/lib/9de/icons";
+
+	n = 0;
+	for(i=0; i<nb; i++){
+		if(size > 0)
+			snprint(p[n++], sizeof p[0], "%s/%s/%d/icon.bit", base[i], app, size);
+		snprint(p[n++], sizeof p[0], "%s/%s/icon.bit", base[i], app);
+	}
+	return n;
+}
+
+static Ui9IconCache* cache(Ui9*);
+static PackEnt* packlookup(Ui9*, char*, int);
+static Image* packcopy(Ui9*, PackEnt*);
+
+/*
+ * Load the directory index once per cache. A stale or missing one is
+ * rebuilt in memory and written back for the next process.
+ */
+static Ui9IconIndex*
+loadindex(Ui9IconCache *c)
+{
+	char p[512], *h;
+	int stale;
+
+	if(c->idxtried)
+		return c->idx;
+	c->idxtried = 1;
+	h = home();
+	if(h == nil)
+		return nil;
+	snprint(p, sizeof p, "%s/lib/9de/icons/index", h);
+	c->idx = ui9icon_indexread(p);
+	stale = c->idx != nil;
+	if(c->idx != nil && ui9icon_indexfresh(c->idx))
+		goto Done;
+	ui9icon_indexfree(c->idx);
+	c->idx = ui9icon_indexscan();
+	if(c->idx == nil)
+		return nil;
+	if(stale)
+		c->st.rescans++;
+	ui9icon_indexwrite(c->idx, p);   /* best effort: read-only home still works */
+Done:
+	c->st.nindex = ui9icon_indexlen(c->idx);
+	return c->idx;
+}
+
+/* uncached lookup: pack, then index (or filesystem probes) + readimage */
 static Image*
-tryfind(Ui9 *ui, char *base, char *app, int size)
+probe(Ui9 *ui, char *app, int size)
 {
-	char p[512];
+	char p[MaxCand][512], *path;
+	Ui9IconIndex *x;
+	PackEnt *pe;
+	long off;
+	int i, n;
 
-	if(size > 0){
-		snprint(p, sizeof p, "%s/%s/%d/icon.bit", base, app, size);
-		if(access(p, AREAD) == 0)
-			return loadimg(ui, p);
+	if(isabspath(app))
+		return loadimg(ui, app);
+	if((pe = packlookup(ui, app, size)) != nil)
+		return packcopy(ui, pe);
+	x = loadindex(cache(ui));
+	if(x != nil){
+		path = ui9icon_indexlookup(x, app, size, &off);
+		return path != nil ? loadimgat(ui, path, off) : nil;
 	}
-	snprint(p, sizeof p, "%s/%s/icon.bit", base, app);
-	if(access(p, AREAD) == 0)
-		return loadimg(ui, p);
 
+	n = candidates(app, size, p);
+	for(i=0; i<n; i++)
+		if(access(p[i], AREAD) == 0)
+			return loadimg(ui, p[i]);
 	return nil;
 }
 
-Image*
-ui9icon_find(Ui9 *ui, char *app, int size)
+/* ----------------- cache ----------------- */
+
+static Ui9IconCache*
+cache(Ui9 *ui)
 {
-	char *h;
-	Image *img;
+	Ui9IconCache *c;
+
+	if(ui->icons != nil)
+		return ui->icons;
+	c = mallocz(sizeof *c, 1);
+	if(c == nil)
+		sysfatal("ui9icon: malloc: %r");
+	c->maxpixels = Ui9IconMaxPixels;
+	c->negttl = Ui9IconNegTTL;
+	c->work.l = &c->lk;
+	c->wakefd[0] = c->wakefd[1] = -1;
+	ui->icons = c;
+	return c;
+}
+
+static uint
+hash(char *app, int size)
+{
+	return (ui9_idstr(app) ^ (ulong)size*2654435761UL) % IconHash;
+}
+
+static uint
+ihash(Image *img)
+{
+	return ui9_idptr(img) % IconHash;
+}
+
+static void
+lrounlink(Ui9IconCache *c, Icon *e)
+{
+	if(e->lprev != nil)
+		e->lprev->lnext = e->lnext;
+	else
+		c->head = e->lnext;
+	if(e->lnext != nil)
+		e->lnext->lprev = e->lprev;
+	else
+		c->tail = e->lprev;
+	e->lprev = e->lnext = nil;
+}
+
+static void
+lrufront(Ui9IconCache *c, Icon *e)
+{
+	e->lprev = nil;
+	e->lnext = c->head;
+	if(c->head != nil)
+		c->head->lprev = e;
+	c->head = e;
+	if(c->tail == nil)
+		c->tail = e;
+}
+
+static void
+touch(Ui9IconCache *c, Icon *e)
+{
+	if(c->head == e)
+		return;
+	lrounlink(c, e);
+	lrufront(c, e);
+}
+
+static void
+drop(Ui9IconCache *c, Icon *e)
+{
+	Icon **l;
+
+	for(l = &c->tab[hash(e->app, e->size)]; *l != nil; l = &(*l)->hnext)
+		if(*l == e){
+			*l = e->hnext;
+			break;
+		}
+	lrounlink(c, e);
+
+	if(e->img != nil){
+		for(l = &c->itab[ihash(e->img)]; *l != nil; l = &(*l)->inext)
+			if(*l == e){
+				*l = e->inext;
+				break;
+			}
+		c->st.nentries--;
+		c->st.pixels -= e->pixels;
+		c->st.bytes -= e->pixels * e->img->depth / 8;
+		freeimage(e->img);
+	}else
+		c->st.nneg--;
+	free(e->app);
+	free(e);
+}
+
+/* evict unreferenced entries from the LRU tail until under the cap */
+static void
+evict(Ui9IconCache *c)
+{
+	Icon *e, *prev;
+
+	for(e = c->tail; e != nil && c->st.pixels > c->maxpixels; e = prev){
+		prev = e->lprev;
+		if(e->img == nil || e->ref > 0)
+			continue;
+		drop(c, e);
+		c->st.evictions++;
+	}
+}
 
-	if(app == nil)
+/* drop expired negative entries; keeps misses on unique names bounded */
+static void
+prune(Ui9IconCache *c)
+{
+	Icon *e, *next;
+	vlong now;
+
+	now = ui9nowms();
+	for(e = c->head; e != nil; e = next){
+		next = e->lnext;
+		if(e->img == nil && e->expires <= now)
+			drop(c, e);
+	}
+}
+
+static Icon*
+lookup(Ui9IconCache *c, char *app, int size)
+{
+	Icon *e;
+
+	for(e = c->tab[hash(app, size)]; e != nil; e = e->hnext)
+		if(e->size == size && strcmp(e->app, app) == 0)
+			return e;
+	return nil;
+}
+
+static Icon*
+insert(Ui9IconCache *c, char *app, int size, Image *img)
+{
+	Icon *e;
+	uint h;
+
+	e = mallocz(sizeof *e, 1);
+	if(e == nil)
 		return nil;
+	e->app = strdup(app);
+	if(e->app == nil){
+		free(e);
+		return nil;
+	}
+	e->size = size;
+	e->img = img;
 
-	/* absolute path? */
-	if(app[0] == '/' || (app[0]=='.' && (app[1]=='/' || (app[1]=='.' && app[2]=='/'))))
-		return loadimg(ui, app);
+	h = hash(app, size);
+	e->hnext = c->tab[h];
+	c->tab[h] = e;
+	lrufront(c, e);
+
+	if(img != nil){
+		h = ihash(img);
+		e->inext = c->itab[h];
+		c->itab[h] = e;
+		e->pixels = (vlong)Dx(img->r) * Dy(img->r);
+		c->st.nentries++;
+		c->st.pixels += e->pixels;
+		c->st.bytes += e->pixels * img->depth / 8;
+	}else{
+		e->expires = ui9nowms() + c->negttl;
+		c->st.nneg++;
+		if(c->st.nneg > IconMaxNeg)
+			prune(c);
+	}
+	return e;
+}
+
+/* cached find; size 0 means the unsized icon.bit */
+static Image*
+cachedfind(Ui9 *ui, char *app, int size)
+{
+	Ui9IconCache *c;
+	Icon *e;
+	Image *img;
+
+	c = cache(ui);
+	e = lookup(c, app, size);
+	if(e != nil){
+		if(e->img != nil){
+			c->st.hits++;
+			e->ref++;
+			touch(c, e);
+			return e->img;
+		}
+		if(e->expires > ui9nowms()){
+			c->st.neghits++;
+			return nil;
+		}
+		drop(c, e);   /* negative entry expired: probe again */
+	}
+
+	c->st.misses++;
+	img = probe(ui, app, size);
+	e = insert(c, app, size, img);
+	if(e == nil)
+		return img;   /* out of memory: caller gets an uncached image */
+	if(img != nil){
+		e->ref++;
+		evict(c);
+	}
+	return img;
+}
+
+/* ----------------- pack ----------------- */
+
+static int
+packcmp(void *va, void *vb)
+{
+	PackEnt *a = va, *b = vb;
+	int c;
+
+	c = strcmp(a->app, b->app);
+	if(c != 0)
+		return c;
+	return a->size - b->size;
+}
+
+static void
+freepack(Ui9IconCache *c)
+{
+	int i;
+
+	for(i=0; i<c->npack; i++)
+		free(c->pack[i].app);
+	free(c->pack);
+	c->pack = nil;
+	c->npack = 0;
+	if(c->atlas != nil){
+		freeimage(c->atlas);
+		c->atlas = nil;
+	}
+}
+
+/* parse "app size minx miny maxx maxy" lines; returns entry count */
+static int
+parseindex(char *buf, PackEnt **pe)
+{
+	char *ln, *nl, *f[6];
+	PackEnt *e;
+	int n, cap;
+
+	e = nil;
+	n = cap = 0;
+	for(ln = buf; *ln != 0; ln = nl){
+		nl = strchr(ln, '\n');
+		if(nl == nil)
+			nl = ln + strlen(ln);
+		else
+			*nl++ = 0;
+		if(tokenize(ln, f, nelem(f)) != 6)
+			continue;
+		if(n == cap){
+			cap = cap ? cap*2 : 64;
+			e = realloc(e, cap * sizeof *e);
+			if(e == nil)
+				return -1;
+		}
+		e[n].app = strdup(f[0]);
+		if(e[n].app == nil)
+			break;
+		e[n].size = atoi(f[1]);
+		e[n].r = Rect(atoi(f[2]), atoi(f[3]), atoi(f[4]), atoi(f[5]));
+		n++;
+	}
+	*pe = e;
+	return n;
+}
+
+static int
+loadpackfile(Ui9 *ui, Ui9IconCache *c, char *path)
+{
+	char hdr[Ui9IconPackHdr+1], *idx;
+	int fd, nidx, i;
+
+	fd = open(path, OREAD);
+	if(fd < 0)
+		return 0;
+	if(readn(fd, hdr, Ui9IconPackHdr) != Ui9IconPackHdr
+	|| strncmp(hdr, UI9ICONPACK " ", strlen(UI9ICONPACK)+1) != 0){
+		close(fd);
+		return 0;
+	}
+	hdr[Ui9IconPackHdr] = 0;
+	nidx = atoi(hdr + strlen(UI9ICONPACK) + 1);
+	if(nidx <= 0 || nidx > 16*1024*1024){
+		close(fd);
+		return 0;
+	}
+
+	idx = malloc(nidx+1);
+	if(idx == nil || readn(fd, idx, nidx) != nidx){
+		free(idx);
+		close(fd);
+		return 0;
+	}
+	idx[nidx] = 0;
+
+	/* one readimage for every icon in the pack */
+	c->atlas = readimage(ui->d, fd, 0);
+	close(fd);
+	c->npack = parseindex(idx, &c->pack);
+	free(idx);
+	if(c->atlas == nil || c->npack <= 0){
+		freepack(c);
+		return 0;
+	}
+
+	for(i=0; i<c->npack; i++)
+		if(!rectinrect(c->pack[i].r, c->atlas->r)){
+			freepack(c);
+			return 0;
+		}
+	qsort(c->pack, c->npack, sizeof c->pack[0], packcmp);
+	c->st.npack = c->npack;
+	snprint(c->packpath, sizeof c->packpath, "%s", path);
+	return 1;
+}
+
+static void
+loadpack(Ui9 *ui, Ui9IconCache *c)
+{
+	char p[512], *h;
+
+	if(c->packtried)
+		return;
+	c->packtried = 1;
 
 	h = home();
 	if(h != nil){
-		char base[256];
-		snprint(base, sizeof base, "%s/lib/9de/icons", h);
-		img = tryfind(ui, base, app, size);
-		if(img != nil)
-			return img;
+		snprint(p, sizeof p, "%s/lib/9de/icons/icons.pack", h);
+		if(loadpackfile(ui, c, p))
+			return;
+	}
+	loadpackfile(ui, c, "/lib/9de/icons/icons.pack");
+}
+
+static PackEnt*
+packfind(Ui9IconCache *c, char *app, int size)
+{
+	PackEnt key;
+
+	if(c->npack == 0)
+		return nil;
+	key.app = app;
+	key.size = size;
+	return bsearch(&key, c->pack, c->npack, sizeof c->pack[0], packcmp);
+}
+
+/* same order as the file search: sized first, then unsized */
+static PackEnt*
+packlookup(Ui9 *ui, char *app, int size)
+{
+	Ui9IconCache *c;
+	PackEnt *e;
+
+	if(isabspath(app))
+		return nil;
+	c = cache(ui);
+	loadpack(ui, c);
+	e = nil;
+	if(size > 0)
+		e = packfind(c, app, size);
+	if(e == nil)
+		e = packfind(c, app, 0);
+	return e;
+}
+
+/* an icon-sized image for e, drawn from the atlas: no file I/O */
+static Image*
+packcopy(Ui9 *ui, PackEnt *e)
+{
+	Ui9IconCache *c;
+	Image *img;
+
+	c = cache(ui);
+	img = allocimage(ui->d, Rect(0, 0, Dx(e->r), Dy(e->r)), c->atlas->chan, 0, DNofill);
+	if(img == nil)
+		return nil;
+	draw(img, img->r, c->atlas, nil, e->r.min);
+	c->st.packed++;
+	return img;
+}
+
+Image*
+ui9icon_findr(Ui9 *ui, char *app, int size, Rectangle *r)
+{
+	Ui9IconCache *c;
+	PackEnt *e;
+	Image *img;
+
+	if(ui == nil || app == nil)
+		return nil;
+	c = cache(ui);
+	if((e = packlookup(ui, app, size)) != nil){
+		c->st.hits++;
+		if(r != nil)
+			*r = e->r;
+		return c->atlas;
+	}
+
+	img = cachedfind(ui, app, size);
+	if(img != nil && r != nil)
+		*r = img->r;
+	return img;
+}
+
+int
+ui9icon_draw(Ui9 *ui, Point p, char *app, int size)
+{
+	Image *img;
+	Rectangle r;
+
+	img = ui9icon_findr(ui, app, size, &r);
+	if(img == nil)
+		return 0;
+	draw(ui->dst, rectaddpt(rectsubpt(r, r.min), p), img, nil, r.min);
+	ui->nops++;
+	ui9icon_put(ui, img);
+	return 1;
+}
+
+/* ----------------- async ----------------- */
+
+static uchar*
+readall(char *path, int *np)
+{
+	Dir *d;
+	uchar *buf;
+	int fd, n;
+
+	fd = open(path, OREAD);
+	if(fd < 0)
+		return nil;
+	d = dirfstat(fd);
+	if(d == nil || d->length <= 0 || d->length > 64*1024*1024){
+		free(d);
+		close(fd);
+		return nil;
+	}
+	n = d->length;
+	free(d);
+	buf = malloc(n);
+	if(buf != nil && readn(fd, buf, n) != n){
+		free(buf);
+		buf = nil;
+	}
+	close(fd);
+	*np = n;
+	return buf;
+}
+
+/*
+ * Worker side: read the file and parse the image(6) header so the UI
+ * proc only has to allocimage + (c)loadimage. Old-style headers that
+ * strtochan does not know are left to the synchronous path.
+ */
+static void
+decode(Job *j)
+{
+	char p[MaxCand][512], hdr[5*12+1], *f[5];
+	int i, n, len;
+
+	j->ok = 0;
+	if(j->path != nil)
+		j->buf = readall(j->path, &j->n);
+	else{
+		n = candidates(j->app, j->size, p);
+		for(i=0; i<n; i++)
+			if((j->buf = readall(p[i], &j->n)) != nil)
+				break;
+	}
+	if(j->buf == nil || j->foff >= j->n)
+		return;
+
+	j->off = j->foff;
+	if(j->n - j->foff >= 11 && memcmp(j->buf + j->foff, "compressed\n", 11) == 0){
+		j->compressed = 1;
+		j->off = j->foff + 11;
+	}
+	if(j->n - j->off < 5*12)
+		return;
+	memmove(hdr, j->buf + j->off, 5*12);
+	hdr[5*12] = 0;
+	if(tokenize(hdr, f, 5) != 5)
+		return;
+	j->chan = strtochan(f[0]);
+	if(j->chan == 0)
+		return;
+	j->r = Rect(atoi(f[1]), atoi(f[2]), atoi(f[3]), atoi(f[4]));
+	if(Dx(j->r) <= 0 || Dy(j->r) <= 0)
+		return;
+	j->off += 5*12;
+
+	if(!j->compressed){
+		len = bytesperline(j->r, chantodepth(j->chan)) * Dy(j->r);
+		if(j->n - j->off < len)
+			return;
+	}
+	j->ok = 1;
+}
+
+static void
+worker(Ui9IconCache *c)
+{
+	Job *j;
+	int wake;
+
+	for(;;){
+		qlock(&c->lk);
+		for(;;){
+			if(c->quit){
+				c->workerdone = 1;
+				qunlock(&c->lk);
+				return;
+			}
+			for(j = c->jobs; j != nil; j = j->next)
+				if(j->state == JobQueued)
+					break;
+			if(j != nil)
+				break;
+			rsleep(&c->work);
+		}
+		j->state = JobBusy;
+		qunlock(&c->lk);
+
+		decode(j);
+
+		qlock(&c->lk);
+		j->state = JobDone;
+		wake = c->wantwake && c->wakefd[1] >= 0;
+		qunlock(&c->lk);
+		if(wake)
+			write(c->wakefd[1], "i", 1);
+	}
+}
+
+static int
+startworker(Ui9IconCache *c)
+{
+	int pid;
+
+	if(c->workerpid > 0)
+		return 1;
+	if(c->wakefd[0] < 0 && pipe(c->wakefd) < 0)   /* kept across failed rforks */
+		c->wakefd[0] = c->wakefd[1] = -1;
+
+	pid = rfork(RFPROC|RFMEM|RFNOWAIT);
+	switch(pid){
+	case -1:
+		return 0;
+	case 0:
+		worker(c);
+		exits(nil);
+	}
+	c->workerpid = pid;
+	return 1;
+}
+
+/* returns 1 once the worker is gone and c may be freed */
+static int
+stopworker(Ui9IconCache *c)
+{
+	int i;
+
+	if(c->workerpid <= 0)
+		return 1;
+	qlock(&c->lk);
+	c->quit = 1;
+	rwakeup(&c->work);
+	qunlock(&c->lk);
+
+	/* bounded: the worker is at most one file read away from checking quit */
+	for(i=0; i<200 && !c->workerdone; i++)
+		sleep(10);
+	return c->workerdone;
+}
+
+static void
+freejob(Job *j)
+{
+	Waiter *w, *wn;
+
+	for(w = j->w; w != nil; w = wn){
+		wn = w->next;
+		free(w);
+	}
+	free(j->app);
+	free(j->path);
+	free(j->buf);
+	free(j);
+}
+
+static int
+loadblocks(Image *img, Job *j)
+{
+	uchar *p, *e;
+	char hdr[2*12+1];
+	int miny, maxy, nb;
+
+	p = j->buf + j->off;
+	e = j->buf + j->n;
+	if(!j->compressed)
+		return loadimage(img, j->r, p, bytesperline(j->r, chantodepth(j->chan)) * Dy(j->r)) > 0;
+
+	for(miny = j->r.min.y; miny < j->r.max.y; miny = maxy){
+		if(e - p < 2*12)
+			return 0;
+		memmove(hdr, p, 2*12);
+		hdr[2*12] = 0;
+		maxy = atoi(hdr);
+		nb = atoi(hdr+12);
+		p += 2*12;
+		if(maxy <= miny || maxy > j->r.max.y || nb <= 0 || nb > e - p)
+			return 0;
+		if(cloadimage(img, Rect(j->r.min.x, miny, j->r.max.x, maxy), p, nb) < 0)
+			return 0;
+		p += nb;
 	}
+	return 1;
+}
 
-	img = tryfind(ui, "/lib/9de/icons", app, size);
+/* UI proc: the only place async results touch the display */
+static Image*
+upload(Ui9 *ui, Job *j)
+{
+	Image *img;
+
+	img = allocimage(ui->d, j->r, j->chan, 0, DNofill);
+	if(img == nil)
+		return nil;
+	if(!loadblocks(img, j)){
+		freeimage(img);
+		return nil;
+	}
 	return img;
 }
 
+/* themed: a surface2 tile with the border token, drawn through the prims */
+static void
+phpaint(Ui9 *ui, Image *img)
+{
+	Image *odst;
+	ulong onops;
+	int rad;
+
+	drawop(img, img->r, ui->d->transparent, nil, ZP, S);   /* a repaint starts clear */
+	odst = ui->dst;
+	onops = ui->nops;
+	ui->dst = img;
+	rad = ui->theme.radius;
+	if(rad > Dx(img->r)/4)
+		rad = Dx(img->r)/4;
+	ui9_roundrect(ui, img->r, rad, ui9img(ui, Ui9CSurface2));
+	if(ui9visible(ui, Ui9CBorder))
+		border(img, img->r, 1, ui9img(ui, Ui9CBorder), ZP);
+	ui->dst = odst;
+	ui->nops = onops;
+}
+
+/*
+ * Callers hold placeholders without a reference, so one is never freed
+ * or replaced while the cache lives: the first NPlaceholder sizes get
+ * one each, later sizes get nil until their decode lands.
+ */
+static Image*
+placeholder(Ui9 *ui, Ui9IconCache *c, int size)
+{
+	Image *img;
+	int i;
+
+	if(size <= 0)
+		size = 16;
+	for(i=0; i<c->nph; i++)
+		if(c->phsize[i] == size)
+			return c->ph[i];
+	if(c->nph == NPlaceholder)
+		return nil;
+
+	img = allocimage(ui->d, Rect(0, 0, size, size), RGBA32, 0, DTransparent);
+	if(img == nil)
+		return nil;
+	phpaint(ui, img);
+	c->ph[c->nph] = img;
+	c->phsize[c->nph] = size;
+	c->nph++;
+	return img;
+}
+
+static int
+isplaceholder(Ui9IconCache *c, Image *img)
+{
+	int i;
+
+	for(i=0; i<c->nph; i++)
+		if(c->ph[i] == img)
+			return 1;
+	return 0;
+}
+
+static void
+freeplaceholders(Ui9IconCache *c)
+{
+	int i;
+
+	for(i=0; i<c->nph; i++)
+		freeimage(c->ph[i]);
+	c->nph = 0;
+}
+
+Image*
+ui9icon_find_async(Ui9 *ui, char *app, int size, Rectangle r, Ui9IconFn cb, void *arg)
+{
+	Ui9IconCache *c;
+	Icon *e;
+	Job *j, **l;
+	Waiter *w;
+	char *path;
+	long off;
+
+	if(ui == nil || app == nil)
+		return nil;
+	c = cache(ui);
+	e = lookup(c, app, size);
+	if(e != nil){
+		if(e->img != nil){
+			c->st.hits++;
+			e->ref++;
+			touch(c, e);
+			return e->img;
+		}
+		if(e->expires > ui9nowms()){
+			c->st.neghits++;
+			return nil;
+		}
+		drop(c, e);
+	}
+
+	/* packed: a copy out of the atlas is cheaper than a worker round trip */
+	if(packlookup(ui, app, size) != nil)
+		return cachedfind(ui, app, size);
+
+	/* indexed: a miss needs no worker, a hit needs no search */
+	path = nil;
+	if(!isabspath(app) && loadindex(c) != nil){
+		path = ui9icon_indexlookup(c->idx, app, size, &off);
+		if(path == nil){
+			c->st.misses++;
+			insert(c, app, size, nil);
+			return nil;
+		}
+	}
+
+	if(!startworker(c))
+		return cachedfind(ui, app, size);
+
+	c->st.async++;
+	qlock(&c->lk);
+	for(l = &c->jobs; (j = *l) != nil; l = &j->next)
+		if(j->size == size && strcmp(j->app, app) == 0)
+			break;
+	if(j != nil)
+		c->st.merged++;
+	else{
+		j = mallocz(sizeof *j, 1);
+		if(j == nil || (j->app = strdup(app)) == nil){
+			free(j);
+			qunlock(&c->lk);
+			return placeholder(ui, c, size);
+		}
+		if(path != nil){
+			j->path = strdup(path);   /* the index may be replaced under the worker */
+			j->foff = off;
+		}
+		j->size = size;
+		j->state = JobQueued;
+		*l = j;     /* FIFO */
+		rwakeup(&c->work);
+	}
+	if(cb != nil && (w = mallocz(sizeof *w, 1)) != nil){
+		w->r = r;
+		w->cb = cb;
+		w->arg = arg;
+		w->next = j->w;
+		j->w = w;
+	}
+	qunlock(&c->lk);
+
+	return placeholder(ui, c, size);
+}
+
+int
+ui9icon_poll(Ui9 *ui)
+{
+	Ui9IconCache *c;
+	Job *done, *j, *jn, **l;
+	Waiter *w;
+	Image *img;
+	int n;
+
+	if(ui == nil || ui->icons == nil || ui->icons->jobs == nil)
+		return 0;
+	c = ui->icons;
+
+	done = nil;
+	qlock(&c->lk);
+	for(l = &c->jobs; (j = *l) != nil; ){
+		if(j->state == JobDone){
+			*l = j->next;
+			j->next = done;
+			done = j;
+		}else
+			l = &j->next;
+	}
+	qunlock(&c->lk);
+
+	n = 0;
+	for(j = done; j != nil; j = jn){
+		jn = j->next;
+		img = j->ok ? upload(ui, j) : nil;
+		if(img == nil && j->buf != nil)
+			img = probe(ui, j->app, j->size);   /* found but not parsed: let readimage try */
+		if(lookup(c, j->app, j->size) == nil){
+			c->st.misses++;
+			insert(c, j->app, j->size, img);
+			evict(c);
+		}else if(img != nil)
+			freeimage(img);   /* a synchronous find got there first */
+
+		/* misses too: the placeholder has to go */
+		for(w = j->w; w != nil; w = w->next)
+			w->cb(ui, w->r, w->arg);
+		freejob(j);
+		n++;
+	}
+	return n;
+}
+
+int
+ui9icon_asyncfd(Ui9 *ui)
+{
+	Ui9IconCache *c;
+
+	if(ui == nil)
+		return -1;
+	c = cache(ui);
+	if(!startworker(c))
+		return -1;
+	qlock(&c->lk);
+	c->wantwake = 1;
+	qunlock(&c->lk);
+	return c->wakefd[0];
+}
+
+Image*
+ui9icon_find(Ui9 *ui, char *app, int size)
+{
+	if(ui == nil || app == nil)
+		return nil;
+	return cachedfind(ui, app, size);
+}
+
 Image*
 ui9icon_any(Ui9 *ui, char *app)
 {
@@ -92,3 +1128,428 @@ ui9icon_any(Ui9 *ui, char *app)
 	}
 	return ui9icon_find(ui, app, 0);
 }
+
+/* ----------------- scaled ----------------- */
+
+/* 1 if app ships its own image at size (not the unsized fallback); no decode */
+static int
+hassize(Ui9 *ui, char *app, int size)
+{
+	char p[MaxCand][512], *path, *path0;
+	Ui9IconIndex *x;
+	long off, off0;
+	int i, n;
+
+	loadpack(ui, cache(ui));
+	if(packfind(cache(ui), app, size) != nil)
+		return 1;
+	x = loadindex(cache(ui));
+	if(x != nil){
+		path = ui9icon_indexlookup(x, app, size, &off);
+		if(path == nil)
+			return 0;
+		path0 = ui9icon_indexlookup(x, app, 0, &off0);
+		return path0 == nil || strcmp(path, path0) != 0 || off != off0;
+	}
+	n = candidates(app, size, p);
+	for(i=0; i<n; i+=2)     /* sized, unsized per base */
+		if(access(p[i], AREAD) == 0)
+			return 1;
+	return 0;
+}
+
+/*
+ * pick the source to scale from: the smallest shipped size >= size,
+ * else the unsized icon.bit or the largest shipped size below, whichever
+ * is bigger. Sizes are resolved by path, so at most two images decode.
+ * *from gets the size picked, 0 for the unsized icon.
+ */
+static Image*
+bestsource(Ui9 *ui, char *app, int size, int *from)
+{
+	static int sizes[] = { 16, 20, 24, 32, 48, 64, 128, 256 };
+	Image *img, *best;
+	int i, below;
+
+	*from = 0;
+	if(isabspath(app))
+		return cachedfind(ui, app, 0);
+	below = 0;
+	for(i=0; i<nelem(sizes); i++){
+		if(!hassize(ui, app, sizes[i]))
+			continue;
+		if(sizes[i] >= size && (best = cachedfind(ui, app, sizes[i])) != nil){
+			*from = sizes[i];
+			return best;
+		}
+		if(sizes[i] < size)
+			below = sizes[i];
+	}
+	best = below ? cachedfind(ui, app, below) : nil;
+	img = cachedfind(ui, app, 0);
+	if(img == nil){
+		*from = best != nil ? below : 0;
+		return best;
+	}
+	if(best == nil || Dx(img->r) > Dx(best->r)){
+		if(best != nil)
+			ui9icon_put(ui, best);
+		return img;
+	}
+	ui9icon_put(ui, img);
+	*from = below;
+	return best;
+}
+
+/* the file probe() would read for (app, size), without reading it */
+static int
+srcpath(Ui9 *ui, char *app, int size, char *p, int np)
+{
+	char cand[MaxCand][512], *path;
+	Ui9IconCache *c;
+	long off;
+	int i, n;
+
+	c = cache(ui);
+	if(isabspath(app)){
+		snprint(p, np, "%s", app);
+		return 1;
+	}
+	if(packlookup(ui, app, size) != nil){
+		snprint(p, np, "%s", c->packpath);
+		return 1;
+	}
+	if(loadindex(c) != nil){
+		path = ui9icon_indexlookup(c->idx, app, size, &off);
+		if(path == nil)
+			return 0;
+		snprint(p, np, "%s", path);
+		return 1;
+	}
+	n = candidates(app, size, cand);
+	for(i=0; i<n; i++)
+		if(access(cand[i], AREAD) == 0){
+			snprint(p, np, "%s", cand[i]);
+			return 1;
+		}
+	return 0;
+}
+
+/*
+ * what a scaled cache file was made from: the source size and the
+ * source file's identity. Any edit, replacement or move of the source
+ * changes the stamp.
+ */
+static int
+srcstamp(Ui9 *ui, char *app, int from, char *s, int ns)
+{
+	char p[512];
+	Dir *d;
+
+	if(!srcpath(ui, app, from, p, sizeof p))
+		return 0;
+	d = dirstat(p);
+	if(d == nil)
+		return 0;
+	snprint(s, ns, "%d %s %llux %lud %lud %lld\n",
+		from, p, d->qid.path, d->qid.vers, d->mtime, d->length);
+	free(d);
+	return 1;
+}
+
+/* 1 if app can name a directory under icons/cache */
+static int
+cachename(char *app)
+{
+	return app[0] != 0 && strchr(app, '/') == nil
+		&& strcmp(app, ".") != 0 && strcmp(app, "..") != 0;
+}
+
+static Image*
+resampleimg(Ui9 *ui, Image *src, int size)
+{
+	Image *tmp, *out;
+	uchar *sb, *db;
+	int sw, sh, dw, dh;
+
+	sw = Dx(src->r);
+	sh = Dy(src->r);
+	if(sw >= sh){
+		dw = size;
+		dh = sh*size / sw;
+	}else{
+		dh = size;
+		dw = sw*size / sh;
+	}
+	if(dw < 1) dw = 1;
+	if(dh < 1) dh = 1;
+
+	/* normalise to RGBA32 so the kernel sees one layout */
+	tmp = allocimage(ui->d, Rect(0, 0, sw, sh), RGBA32, 0, DTransparent);
+	out = allocimage(ui->d, Rect(0, 0, dw, dh), RGBA32, 0, DTransparent);
+	sb = malloc(sw*sh*4);
+	db = malloc(dw*dh*4);
+	if(tmp == nil || out == nil || sb == nil || db == nil)
+		goto Fail;
+	draw(tmp, tmp->r, src, nil, src->r.min);
+	if(unloadimage(tmp, tmp->r, sb, sw*sh*4) != sw*sh*4)
+		goto Fail;
+	if(ui9icon_resample(sb, sw, sh, db, dw, dh) < 0)
+		goto Fail;
+	if(loadimage(out, out->r, db, dw*dh*4) != dw*dh*4)
+		goto Fail;
+	freeimage(tmp);
+	free(sb);
+	free(db);
+	return out;
+
+Fail:
+	if(tmp != nil) freeimage(tmp);
+	if(out != nil) freeimage(out);
+	free(sb);
+	free(db);
+	return nil;
+}
+
+static void
+scaledpath(char *p, int np, char *h, char *app, int size, char *ext)
+{
+	snprint(p, np, "%s/lib/9de/icons/cache/%s/%d.%s", h, app, size, ext);
+}
+
+/*
+ * the cached <size>.bit for app, if its <size>.src stamp still matches
+ * the source it was resampled from
+ */
+static Image*
+readscaled(Ui9 *ui, char *app, int size)
+{
+	char p[512], old[640], now[640], *h;
+	int fd, n, from;
+
+	h = home();
+	if(h == nil || !cachename(app))
+		return nil;
+	scaledpath(p, sizeof p, h, app, size, "src");
+	fd = open(p, OREAD);
+	if(fd < 0)
+		return nil;
+	n = readn(fd, old, sizeof old - 1);
+	close(fd);
+	if(n <= 0)
+		return nil;
+	old[n] = 0;
+	from = atoi(old);
+	if(!srcstamp(ui, app, from, now, sizeof now) || strcmp(old, now) != 0)
+		return nil;
+	scaledpath(p, sizeof p, h, app, size, "bit");
+	return loadimg(ui, p);
+}
+
+/* best effort: a failed write only costs a resample next launch */
+static void
+writescaled(Ui9 *ui, char *app, int size, int from, Image *img)
+{
+	char p[512], s[640], *h;
+	int fd;
+
+	h = home();
+	if(h == nil || !cachename(app) || !srcstamp(ui, app, from, s, sizeof s))
+		return;
+	snprint(p, sizeof p, "%s/lib/9de/icons/cache", h);
+	if(access(p, AEXIST) < 0 && (fd = create(p, OREAD, DMDIR|0755)) >= 0)
+		close(fd);
+	snprint(p, sizeof p, "%s/lib/9de/icons/cache/%s", h, app);
+	if(access(p, AEXIST) < 0 && (fd = create(p, OREAD, DMDIR|0755)) >= 0)
+		close(fd);
+
+	/* stamp last: a half-written pair never validates */
+	scaledpath(p, sizeof p, h, app, size, "src");
+	remove(p);
+	scaledpath(p, sizeof p, h, app, size, "bit");
+	fd = create(p, OWRITE, 0644);
+	if(fd < 0)
+		return;
+	if(writeimage(fd, img, 0) < 0){
+		close(fd);
+		remove(p);
+		return;
+	}
+	close(fd);
+	scaledpath(p, sizeof p, h, app, size, "src");
+	fd = create(p, OWRITE, 0644);
+	if(fd < 0)
+		return;
+	if(write(fd, s, strlen(s)) != strlen(s)){
+		close(fd);
+		remove(p);
+		return;
+	}
+	close(fd);
+}
+
+Image*
+ui9icon_scaled(Ui9 *ui, char *app, int size)
+{
+	Ui9IconCache *c;
+	Icon *e;
+	Image *img, *src;
+	int from;
+
+	if(ui == nil || app == nil)
+		return nil;
+	if(size <= 0)
+		return ui9icon_any(ui, app);
+
+	/* scaled results live under (app, -size), apart from find's keys */
+	c = cache(ui);
+	e = lookup(c, app, -size);
+	if(e != nil && e->img != nil){
+		c->st.hits++;
+		e->ref++;
+		touch(c, e);
+		return e->img;
+	}
+
+	/* shipped at this size: nothing to do */
+	img = cachedfind(ui, app, size);
+	if(img != nil){
+		if(Dx(img->r) == size || Dy(img->r) == size)
+			return img;
+		ui9icon_put(ui, img);
+	}
+
+	/* written by an earlier launch from the same source */
+	img = readscaled(ui, app, size);
+
+	if(img == nil){
+		src = bestsource(ui, app, size, &from);
+		if(src == nil)
+			return nil;
+		img = resampleimg(ui, src, size);
+		ui9icon_put(ui, src);
+		if(img == nil)
+			return nil;
+		c->st.scaled++;
+		writescaled(ui, app, size, from, img);
+	}
+
+	e = insert(c, app, -size, img);
+	if(e == nil)
+		return img;
+	e->ref++;
+	evict(c);
+	return img;
+}
+
+void
+ui9icon_put(Ui9 *ui, Image *img)
+{
+	Ui9IconCache *c;
+	Icon *e;
+
+	if(ui == nil || img == nil)
+		return;
+	c = ui->icons;
+	if(c != nil && (img == c->atlas || isplaceholder(c, img)))
+		return;   /* atlas and placeholders live as long as the cache */
+	if(c != nil)
+		for(e = c->itab[ihash(img)]; e != nil; e = e->inext)
+			if(e->img == img){
+				if(e->ref > 0)
+					e->ref--;
+				evict(c);
+				return;
+			}
+	/* not cached (insert failed): the caller held the only copy */
+	freeimage(img);
+}
+
+void
+ui9icon_limits(Ui9 *ui, vlong maxpixels, long negttlms)
+{
+	Ui9IconCache *c;
+
+	if(ui == nil)
+		return;
+	c = cache(ui);
+	if(maxpixels > 0)
+		c->maxpixels = maxpixels;
+	if(negttlms > 0)
+		c->negttl = negttlms;
+	evict(c);
+}
+
+void
+ui9icon_flush(Ui9 *ui)
+{
+	Ui9IconCache *c;
+	Icon *e, *next;
+	int i;
+
+	if(ui == nil || ui->icons == nil)
+		return;
+	c = ui->icons;
+	for(e = c->head; e != nil; e = next){
+		next = e->lnext;
+		if(e->ref == 0)
+			drop(c, e);
+	}
+	for(i=0; i<c->nph; i++)
+		phpaint(ui, c->ph[i]);   /* themed: repainted in place, callers may hold them */
+	ui9icon_indexfree(c->idx);   /* re-checked against the roots on next use */
+	c->idx = nil;
+	c->idxtried = 0;
+	c->st.nindex = 0;
+}
+
+void
+ui9icon_stats(Ui9 *ui, Ui9IconStats *st)
+{
+	Ui9IconCache *c;
+	Icon *e;
+	Job *j;
+
+	memset(st, 0, sizeof *st);
+	if(ui == nil || ui->icons == nil)
+		return;
+	c = ui->icons;
+	*st = c->st;
+	st->maxpixels = c->maxpixels;
+	for(e = c->head; e != nil; e = e->lnext)
+		if(e->ref > 0)
+			st->nref++;
+	qlock(&c->lk);
+	for(j = c->jobs; j != nil; j = j->next)
+		st->inflight++;
+	qunlock(&c->lk);
+}
+
+void
+ui9icon_free(Ui9 *ui)
+{
+	Ui9IconCache *c;
+	Job *j;
+
+	if(ui == nil || ui->icons == nil)
+		return;
+	c = ui->icons;
+	ui->icons = nil;
+	while(c->head != nil)
+		drop(c, c->head);
+	freepack(c);
+	freeplaceholders(c);
+	ui9icon_indexfree(c->idx);
+	c->idx = nil;
+	if(!stopworker(c))
+		return;   /* worker stuck in a read: leak c rather than free it under it */
+	while((j = c->jobs) != nil){
+		c->jobs = j->next;
+		freejob(j);
+	}
+	if(c->wakefd[0] >= 0){
+		close(c->wakefd[0]);
+		close(c->wakefd[1]);
+	}
+	free(c);
+}
@@ -0,0 +1,493 @@
+#include <u.h>
+#include <libc.h>
+#include <draw.h>
+#include "../include/9deui/9deui.h"
+
+/*
+ * Icon directory index (see icon.h). One walk of the icon roots,
+ * serialized as
+ *
+ *   "9deiconindex 01\n"        16-byte magic
+ *   vers[NRoot]   4 bytes each  root dir qid.vers, ~0 if the root is absent
+ *   nent          4 bytes
+ *   root[NRoot]   2-byte len + path + NUL
+ *   entries       2 size, 1 root, 4 off, 2-byte len + app + NUL,
+ *                 2-byte len + path + NUL
+ *
+ * all big-endian, entries sorted by (app, size, root). Loading keeps the
+ * file in one buffer and points the entries into it.
+ */
+
+enum {
+	NRoot = 2,          /* $home/lib/9de/icons, /lib/9de/icons */
+	MagicLen = 16,
+	VersOff = MagicLen,
+	HdrLen = MagicLen + 4*NRoot + 4,
+};
+
+#define NoRoot ((ulong)0xFFFFFFFF)   /* stored as 4 bytes */
+
+static char magic[] = "9deiconindex 01\n";
+
+typedef struct IdxEnt IdxEnt;
+struct IdxEnt {
+	char *app;
+	int size;
+	int root;
+	long off;           /* where the image starts in path */
+	char *path;
+};
+
+struct Ui9IconIndex {
+	char *root[NRoot];
+	ulong vers[NRoot];
+	IdxEnt *e;
+	int n;
+	int cap;
+	uchar *buf;         /* read: backing store for every string */
+	int nbuf;
+	int owned;          /* scanned: strings are malloc'd */
+};
+
+static ulong
+get(uchar *p, int n)
+{
+	ulong v;
+
+	v = 0;
+	while(n-- > 0)
+		v = v<<8 | *p++;
+	return v;
+}
+
+static uchar*
+put(uchar *p, ulong v, int n)
+{
+	int i;
+
+	for(i=n-1; i>=0; i--){
+		p[i] = v;
+		v >>= 8;
+	}
+	return p+n;
+}
+
+static void
+roots(char *r[NRoot], char *hb, int nhb)
+{
+	char *h;
+
+	h = getenv("home");
+	if(h == nil)
+		h = getenv("HOME");
+	r[0] = nil;
+	if(h != nil){
+		snprint(hb, nhb, "%s/lib/9de/icons", h);
+		r[0] = hb;
+	}
+	r[1] = "/lib/9de/icons";
+}
+
+static ulong
+rootvers(char *path)
+{
+	Dir *d;
+	ulong v;
+
+	if(path == nil || (d = dirstat(path)) == nil)
+		return NoRoot;
+	v = d->qid.vers & 0xFFFFFFFF;
+	free(d);
+	return v;
+}
+
+static int
+entcmp(void *va, void *vb)
+{
+	IdxEnt *a = va, *b = vb;
+	int c;
+
+	c = strcmp(a->app, b->app);
+	if(c != 0)
+		return c;
+	if(a->size != b->size)
+		return a->size - b->size;
+	return a->root - b->root;
+}
+
+void
+ui9icon_indexfree(Ui9IconIndex *x)
+{
+	int i;
+
+	if(x == nil)
+		return;
+	if(x->owned){
+		for(i=0; i<x->n; i++){
+			free(x->e[i].app);
+			free(x->e[i].path);
+		}
+		for(i=0; i<NRoot; i++)
+			free(x->root[i]);
+	}
+	free(x->e);
+	free(x->buf);
+	free(x);
+}
+
+/* ----------------- scan ----------------- */
+
+static int
+isnum(char *s)
+{
+	if(*s == 0)
+		return 0;
+	for(; *s; s++)
+		if(*s < '0' || *s > '9')
+			return 0;
+	return 1;
+}
+
+static int
+add(Ui9IconIndex *x, char *app, int size, int root, char *path)
+{
+	IdxEnt *e;
+
+	if(x->n == x->cap){
+		x->cap = x->cap ? x->cap*2 : 256;
+		e = realloc(x->e, x->cap * sizeof *e);
+		if(e == nil)
+			return -1;
+		x->e = e;
+	}
+	e = &x->e[x->n];
+	e->app = strdup(app);
+	e->path = strdup(path);
+	if(e->app == nil || e->path == nil){
+		free(e->app);
+		free(e->path);
+		return -1;
+	}
+	e->size = size;
+	e->root = root;
+	e->off = 0;
+	x->n++;
+	return 0;
+}
+
+static int
+isfile(char *path)
+{
+	Dir *d;
+	int ok;
+
+	d = dirstat(path);
+	ok = d != nil && !(d->qid.type & QTDIR);
+	free(d);
+	return ok;
+}
+
+static int
+scanapp(Ui9IconIndex *x, int root, char *app)
+{
+	char dir[512], p[512];
+	Dir *d;
+	int fd, n, i, rv;
+
+	snprint(dir, sizeof dir, "%s/%s", x->root[root], app);
+	fd = open(dir, OREAD);
+	if(fd < 0)
+		return 0;
+	n = dirreadall(fd, &d);
+	close(fd);
+	rv = 0;
+	for(i=0; i<n && rv == 0; i++){
+		if(strcmp(d[i].name, "icon.bit") == 0 && !(d[i].qid.type & QTDIR)){
+			snprint(p, sizeof p, "%s/icon.bit", dir);
+			rv = add(x, app, 0, root, p);
+		}else if((d[i].qid.type & QTDIR) && isnum(d[i].name)){
+			snprint(p, sizeof p, "%s/%s/icon.bit", dir, d[i].name);
+			if(isfile(p))
+				rv = add(x, app, atoi(d[i].name), root, p);
+		}
+	}
+	free(d);
+	return rv;
+}
+
+/* walk every root; sizes the tree does not ship are not indexed */
+Ui9IconIndex*
+ui9icon_indexscan(void)
+{
+	Ui9IconIndex *x;
+	char *r[NRoot], hb[256];
+	Dir *d;
+	int fd, n, i, k, rv;
+
+	x = mallocz(sizeof *x, 1);
+	if(x == nil)
+		return nil;
+	x->owned = 1;
+	roots(r, hb, sizeof hb);
+	rv = 0;
+	for(k=0; k<NRoot; k++){
+		x->root[k] = r[k] ? strdup(r[k]) : strdup("");
+		if(x->root[k] == nil)
+			rv = -1;
+		/* vers before the walk: a change during it forces a rescan */
+		x->vers[k] = rootvers(r[k]);
+		if(r[k] == nil || rv < 0 || (fd = open(r[k], OREAD)) < 0)
+			continue;
+		n = dirreadall(fd, &d);
+		close(fd);
+		for(i=0; i<n && rv == 0; i++){
+			if(!(d[i].qid.type & QTDIR) || strcmp(d[i].name, "cache") == 0)
+				continue;
+			rv = scanapp(x, k, d[i].name);
+		}
+		free(d);
+	}
+	if(rv < 0){
+		ui9icon_indexfree(x);
+		return nil;
+	}
+	qsort(x->e, x->n, sizeof x->e[0], entcmp);
+	return x;
+}
+
+/* ----------------- file ----------------- */
+
+static uchar*
+putstr(uchar *p, char *s)
+{
+	int n;
+
+	n = strlen(s) + 1;
+	p = put(p, n, 2);
+	memmove(p, s, n);
+	return p+n;
+}
+
+int
+ui9icon_indexwrite(Ui9IconIndex *x, char *path)
+{
+	char tmp[512], *base;
+	uchar *buf, *p, vb[4];
+	Dir nd;
+	long n;
+	int i, fd, ok, same[NRoot];
+
+	if(x == nil)
+		return -1;
+	n = HdrLen;
+	for(i=0; i<NRoot; i++)
+		n += 2 + strlen(x->root[i]) + 1;
+	for(i=0; i<x->n; i++)
+		n += 2+1+4 + 2+strlen(x->e[i].app)+1 + 2+strlen(x->e[i].path)+1;
+	buf = malloc(n);
+	if(buf == nil)
+		return -1;
+
+	p = buf;
+	memmove(p, magic, MagicLen);
+	p += MagicLen;
+	for(i=0; i<NRoot; i++)
+		p = put(p, x->vers[i], 4);
+	p = put(p, x->n, 4);
+	for(i=0; i<NRoot; i++)
+		p = putstr(p, x->root[i]);
+	for(i=0; i<x->n; i++){
+		p = put(p, x->e[i].size, 2);
+		p = put(p, x->e[i].root, 1);
+		p = put(p, x->e[i].off, 4);
+		p = putstr(p, x->e[i].app);
+		p = putstr(p, x->e[i].path);
+	}
+
+	/* roots unchanged since the walk get re-stamped after the write */
+	for(i=0; i<NRoot; i++)
+		same[i] = rootvers(x->root[i][0] ? x->root[i] : nil) == x->vers[i];
+
+	/* write aside and rename, so a reader never sees half an index */
+	snprint(tmp, sizeof tmp, "%s.tmp%d", path, getpid());
+	fd = create(tmp, OWRITE, 0644);
+	if(fd < 0){
+		free(buf);
+		return -1;
+	}
+	ok = write(fd, buf, n) == n;
+	close(fd);
+	free(buf);
+	base = strrchr(path, '/');
+	base = base ? base+1 : path;
+	nulldir(&nd);
+	nd.name = base;
+	if(ok)
+		remove(path);
+	if(!ok || dirwstat(tmp, &nd) < 0){
+		remove(tmp);
+		return -1;
+	}
+
+	/*
+	 * Creating the index inside a root bumps that root's qid.vers;
+	 * record the versions as they are now, in place.
+	 */
+	fd = open(path, OWRITE);
+	if(fd < 0)
+		return -1;
+	for(i=0; i<NRoot; i++){
+		if(!same[i])
+			continue;   /* changed during the walk: let the next load rescan */
+		x->vers[i] = rootvers(x->root[i][0] ? x->root[i] : nil);
+		put(vb, x->vers[i], 4);
+		pwrite(fd, vb, 4, VersOff + 4*i);
+	}
+	close(fd);
+	return 0;
+}
+
+static char*
+getstr(uchar **pp, uchar *e)
+{
+	uchar *p;
+	int n;
+
+	p = *pp;
+	if(e - p < 2)
+		return nil;
+	n = get(p, 2);
+	p += 2;
+	if(n <= 0 || e - p < n || p[n-1] != 0)
+		return nil;
+	*pp = p+n;
+	return (char*)p;
+}
+
+Ui9IconIndex*
+ui9icon_indexread(char *path)
+{
+	Ui9IconIndex *x;
+	uchar *p, *e;
+	Dir *d;
+	int fd, i, n;
+
+	fd = open(path, OREAD);
+	if(fd < 0)
+		return nil;
+	d = dirfstat(fd);
+	if(d == nil || d->length < HdrLen || d->length > 64*1024*1024){
+		free(d);
+		close(fd);
+		return nil;
+	}
+	x = mallocz(sizeof *x, 1);
+	if(x == nil){
+		free(d);
+		close(fd);
+		return nil;
+	}
+	x->nbuf = d->length;
+	free(d);
+	x->buf = malloc(x->nbuf);
+	if(x->buf == nil || readn(fd, x->buf, x->nbuf) != x->nbuf
+	|| memcmp(x->buf, magic, MagicLen) != 0){
+		close(fd);
+		goto Bad;
+	}
+	close(fd);
+
+	p = x->buf + MagicLen;
+	e = x->buf + x->nbuf;
+	for(i=0; i<NRoot; i++, p += 4)
+		x->vers[i] = get(p, 4);
+	n = get(p, 4);
+	p += 4;
+	if(n < 0 || n > (e - p) / 11)
+		goto Bad;
+	for(i=0; i<NRoot; i++)
+		if((x->root[i] = getstr(&p, e)) == nil)
+			goto Bad;
+	x->e = malloc((n ? n : 1) * sizeof x->e[0]);
+	if(x->e == nil)
+		goto Bad;
+	for(x->n=0; x->n<n; x->n++){
+		if(e - p < 7)
+			goto Bad;
+		x->e[x->n].size = get(p, 2);
+		x->e[x->n].root = p[2];
+		x->e[x->n].off = get(p+3, 4);
+		p += 7;
+		x->e[x->n].app = getstr(&p, e);
+		x->e[x->n].path = getstr(&p, e);
+		if(x->e[x->n].app == nil || x->e[x->n].path == nil || x->e[x->n].root >= NRoot)
+			goto Bad;
+	}
+	return x;
+
+Bad:
+	ui9icon_indexfree(x);
+	return nil;
+}
+
+/* ----------------- lookup ----------------- */
+
+/* 1 if no root was added, removed or changed since the index was built */
+int
+ui9icon_indexfresh(Ui9IconIndex *x)
+{
+	char *r[NRoot], hb[256];
+	int i;
+
+	if(x == nil)
+		return 0;
+	roots(r, hb, sizeof hb);
+	for(i=0; i<NRoot; i++){
+		if(strcmp(r[i] ? r[i] : "", x->root[i]) != 0)
+			return 0;   /* $home moved */
+		if(rootvers(r[i]) != x->vers[i])
+			return 0;
+	}
+	return 1;
+}
+
+static IdxEnt*
+find(Ui9IconIndex *x, char *app, int size, int root)
+{
+	IdxEnt key;
+
+	key.app = app;
+	key.size = size;
+	key.root = root;
+	return bsearch(&key, x->e, x->n, sizeof x->e[0], entcmp);
+}
+
+/* path of the icon the search order in icon.h would pick, or nil */
+char*
+ui9icon_indexlookup(Ui9IconIndex *x, char *app, int size, long *off)
+{
+	IdxEnt *e;
+	int k;
+
+	if(x == nil || app == nil)
+		return nil;
+	for(k=0; k<NRoot; k++){
+		e = nil;
+		if(size > 0)
+			e = find(x, app, size, k);
+		if(e == nil)
+			e = find(x, app, 0, k);
+		if(e != nil){
+			if(off != nil)
+				*off = e->off;
+			return e->path;
+		}
+	}
+	return nil;
+}
+
+int
+ui9icon_indexlen(Ui9IconIndex *x)
+{
+	return x ? x->n : 0;
+}
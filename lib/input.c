@@ -0,0 +1,86 @@
+#include <u.h>
+#include <libc.h>
+#include <draw.h>
+#include <event.h>
+#include "../include/9deui/9deui.h"
+
+/* fold e into the batch; the caller keeps room for one more entry */
+static void
+add(Ui9Events *ev, Event *e, ulong k)
+{
+	Ui9Ev *last;
+
+	last = ev->n > 0 ? &ev->e[ev->n-1] : nil;
+	if(k == Emouse){
+		/* motion folds into motion; a transition keeps its own position */
+		if(e->mouse.buttons == ev->mb && last != nil && last->type == Ui9EvMouse && last->motion){
+			last->m = e->mouse;
+			ev->nmerged++;
+			return;
+		}
+		ev->e[ev->n].type = Ui9EvMouse;
+		ev->e[ev->n].m = e->mouse;
+		ev->e[ev->n].motion = e->mouse.buttons == ev->mb;
+		ev->mb = e->mouse.buttons;
+		ev->n++;
+	}else if(k == Ekeyboard){
+		ev->e[ev->n].type = Ui9EvKey;
+		ev->e[ev->n].k = e->kbdc;
+		ev->n++;
+	}else if(k & ev->datakeys){
+		ev->e[ev->n].type = Ui9EvData;
+		ev->e[ev->n].key = k;
+		ev->e[ev->n].data = ev->buf + ev->nbuf;
+		ev->e[ev->n].n = e->n;
+		memmove(ev->buf + ev->nbuf, e->data, e->n);
+		ev->nbuf += e->n;
+		ev->n++;
+	}
+}
+
+/* room for one more event of any kind */
+static int
+room(Ui9Events *ev)
+{
+	return ev->n < Ui9MaxEv && ev->nbuf + EMAXMSG <= Ui9EvBuf;
+}
+
+static void
+take(Ui9Events *ev, ulong keys)
+{
+	Event e;
+	ulong k;
+
+	k = eread(keys, &e);
+	ev->nread++;
+	if(k == Eresize)
+		ev->resized = 1;
+	else
+		add(ev, &e, k);
+}
+
+/*
+ * Take every pending event for keys off the queue (eread, so other
+ * estart sources are left alone). A full batch stops reading so
+ * nothing is dropped; the rest is read by the next call. Returns the
+ * number of entries in ev->e.
+ */
+int
+ui9_drain(Ui9Events *ev, ulong keys, int wait)
+{
+	ev->n = 0;
+	ev->resized = 0;
+	ev->nread = 0;
+	ev->nmerged = 0;
+	ev->nbuf = 0;
+
+	if(wait && !ecanread(keys))
+		take(ev, keys);
+	while(room(ev) && ecanread(keys))
+		take(ev, keys);
+
+	ev->batches++;
+	ev->read += ev->nread;
+	ev->merged += ev->nmerged;
+	return ev->n;
+}
@@ -3,14 +3,32 @@
 #include <draw.h>
 #include "../include/9deui/9deui.h"
 
+/* 0 if img is a theme token classified Ui9Invisible; unknown images are drawn */
+static int
+imgvisible(Ui9 *ui, Image *img)
+{
+	int i;
+
+	if(img == nil)
+		return 0;
+	for(i=0; i<Ui9CCount; i++)
+		if(ui->img[i] == img)
+			return ui->cls[i] != Ui9Invisible;
+	return 1;
+}
+
 void
 ui9_roundrect(Ui9 *ui, Rectangle r, int rad, Image *fill)
 {
 	Rectangle old;
 	Point c;
 
+	if(!imgvisible(ui, fill))
+		return;
+
 	if(rad <= 0){
 		draw(ui->dst, r, fill, nil, ZP);
+		ui->nops++;
 		return;
 	}
 
@@ -35,6 +53,7 @@ ui9_roundrect(Ui9 *ui, Rectangle r, int rad, Image *fill)
 	fillellipse(ui->dst, c, rad, rad, fill, ZP);
 
 	replclipr(ui->dst, 0, old);
+	ui->nops += 7;
 }
 
 void
@@ -44,8 +63,13 @@ ui9_shadowstring(Ui9 *ui, Point p, char *s)
 	Image *shadow = ui9img(ui, Ui9CShadow);
 	Image *text = ui9img(ui, Ui9CText);
 
-	string(ui->dst, addpt(p, Pt(0,1)), shadow, ZP, f, s);
+	/* terminal style ships shadowa=0: skip the pass instead of drawing nothing */
+	if(ui9visible(ui, Ui9CShadow)){
+		string(ui->dst, addpt(p, Pt(0,1)), shadow, ZP, f, s);
+		ui->nops++;
+	}
 	string(ui->dst, p, text, ZP, f, s);
+	ui->nops++;
 }
 
 void
@@ -61,12 +85,18 @@ void
 ui9_card(Ui9 *ui, Rectangle r, int rad)
 {
 	ui9_roundrect(ui, r, rad, ui9img(ui, Ui9CSurface));
-	border(ui->dst, r, 1, ui9img(ui, Ui9CBorder), ZP);
+	if(ui9visible(ui, Ui9CBorder)){
+		border(ui->dst, r, 1, ui9img(ui, Ui9CBorder), ZP);
+		ui->nops++;
+	}
 }
 
 void
 ui9_card2(Ui9 *ui, Rectangle r, int rad)
 {
 	ui9_roundrect(ui, r, rad, ui9img(ui, Ui9CSurface2));
-	border(ui->dst, r, 1, ui9img(ui, Ui9CBorder), ZP);
+	if(ui9visible(ui, Ui9CBorder)){
+		border(ui->dst, r, 1, ui9img(ui, Ui9CBorder), ZP);
+		ui->nops++;
+	}
 }
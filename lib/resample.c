@@ -0,0 +1,139 @@
+#include <u.h>
+#include <libc.h>
+#include <draw.h>
+#include "../include/9deui/9deui.h"
+
+/*
+ * 32bpp resampling for icons. Pixels are premultiplied (image(6)), so
+ * every byte is filtered the same way and channel order does not matter.
+ * Both kernels walk whole source rows in order.
+ */
+
+/* integer downscale: average fx*fy blocks; acc holds one output row */
+static void
+box(uchar *src, int sw, int sh, uchar *dst, int dw, int dh, ulong *acc)
+{
+	int fx, fy, x, y, yy, c, n;
+	uchar *s, *d;
+	ulong *a;
+
+	USED(sh);
+	fx = sw / dw;
+	fy = sh / dh;
+	n = fx * fy;
+	for(y=0; y<dh; y++){
+		memset(acc, 0, dw*4*sizeof acc[0]);
+		for(yy=0; yy<fy; yy++){
+			s = src + (y*fy + yy)*sw*4;
+			for(x=0; x<sw; x++){
+				a = acc + (x/fx)*4;
+				for(c=0; c<4; c++)
+					a[c] += *s++;
+			}
+		}
+		d = dst + y*dw*4;
+		for(x=0; x<dw*4; x++)
+			d[x] = (acc[x] + n/2) / n;
+	}
+}
+
+/* bilinear, 8-bit fixed point weights; xo/xw map each output column once */
+static void
+bilinear(uchar *src, int sw, int sh, uchar *dst, int dw, int dh, int *xo, int *xw)
+{
+	int x, y, c, fy, y0, y1, wy, x0, x1, wx, top, bot;
+	uchar *r0, *r1, *d;
+
+	for(x=0; x<dw; x++){
+		x0 = ((2*x+1)*sw*256) / (2*dw) - 128;
+		if(x0 < 0) x0 = 0;
+		if(x0 > (sw-1)*256) x0 = (sw-1)*256;
+		xo[x] = x0 >> 8;
+		xw[x] = x0 & 255;
+	}
+
+	d = dst;
+	for(y=0; y<dh; y++){
+		fy = ((2*y+1)*sh*256) / (2*dh) - 128;
+		if(fy < 0) fy = 0;
+		if(fy > (sh-1)*256) fy = (sh-1)*256;
+		y0 = fy >> 8;
+		y1 = (y0+1 < sh) ? y0+1 : y0;
+		wy = fy & 255;
+		r0 = src + y0*sw*4;
+		r1 = src + y1*sw*4;
+		for(x=0; x<dw; x++){
+			x0 = xo[x]*4;
+			x1 = (xo[x]+1 < sw) ? x0+4 : x0;
+			wx = xw[x];
+			for(c=0; c<4; c++){
+				top = r0[x0+c]*(256-wx) + r0[x1+c]*wx;
+				bot = r1[x0+c]*(256-wx) + r1[x1+c]*wx;
+				*d++ = (top*(256-wy) + bot*wy + (1<<15)) >> 16;
+			}
+		}
+	}
+}
+
+/* largest k dividing sw and sh with sw/k >= dw and sh/k >= dh */
+static int
+prebox(int sw, int sh, int dw, int dh)
+{
+	int k;
+
+	for(k = sw/dw; k > 1; k--)
+		if(sw % k == 0 && sh % k == 0 && sh/k >= dh)
+			return k;
+	return 1;
+}
+
+/*
+ * Integer box when the ratio is whole; otherwise bilinear, after a box
+ * pass down to the nearest whole ratio so large reductions (256 -> 20)
+ * still average every source pixel.  Returns -1 on bad sizes or no memory.
+ */
+int
+ui9icon_resample(uchar *src, int sw, int sh, uchar *dst, int dw, int dh)
+{
+	ulong *acc;
+	int *xmap, k, mw, mh;
+	uchar *mid;
+
+	if(sw <= 0 || sh <= 0 || dw <= 0 || dh <= 0)
+		return -1;
+
+	k = 1;
+	if(sw >= dw && sh >= dh)
+		k = prebox(sw, sh, dw, dh);
+	mw = sw / k;
+	mh = sh / k;
+
+	mid = src;
+	if(k > 1){
+		if(mw == dw && mh == dh)
+			mid = dst;
+		else if((mid = malloc(mw*mh*4)) == nil)
+			return -1;
+		if((acc = malloc(mw*4*sizeof acc[0])) == nil){
+			if(mid != dst)
+				free(mid);
+			return -1;
+		}
+		box(src, sw, sh, mid, mw, mh, acc);
+		free(acc);
+		if(mid == dst)
+			return 0;
+	}
+
+	xmap = malloc(dw*2*sizeof xmap[0]);
+	if(xmap == nil){
+		if(mid != src)
+			free(mid);
+		return -1;
+	}
+	bilinear(mid, mw, mh, dst, dw, dh, xmap, xmap + dw);
+	free(xmap);
+	if(mid != src)
+		free(mid);
+	return 0;
+}
@@ -0,0 +1,241 @@
+#include <u.h>
+#include <libc.h>
+#include <draw.h>
+#include "../include/9deui/9deui.h"
+
+/*
+ * Widget state store: open addressing (linear probing) from id to a
+ * Ui9State. ui9_statebegin starts a frame; entries nobody asked for
+ * during the previous frame are dropped there. Deleted slots become
+ * tombstones; when live + dead pass half the table it doubles if live
+ * alone is past a quarter, else the tombstones are swept in place, so
+ * the table only allocates when it grows, never per frame.
+ */
+
+enum {
+	MinStates = 64,
+	AnimStep = 64,      /* t per frame: 0 -> 255 in four frames */
+};
+
+#define Dead ((ulong)~0)
+
+struct Ui9States {
+	Ui9State *tab;
+	int cap;            /* power of two */
+	int live;
+	int dead;
+	ulong frame;
+	int animating;
+};
+
+static ulong
+slot(Ui9States *st, ulong id)
+{
+	return (id * 2654435761UL) & (st->cap-1);
+}
+
+static void
+rehash(Ui9States *st, int cap)
+{
+	Ui9State *old, *s;
+	int i, n;
+	ulong h;
+
+	old = st->tab;
+	n = st->cap;
+	st->tab = mallocz(cap * sizeof st->tab[0], 1);
+	if(st->tab == nil)
+		sysfatal("ui9state: malloc: %r");
+	st->cap = cap;
+	st->live = 0;
+	st->dead = 0;
+	for(i=0; i<n; i++){
+		if(old[i].id == 0 || old[i].id == Dead)
+			continue;
+		for(h = slot(st, old[i].id); (s = &st->tab[h])->id != 0; h = (h+1) & (cap-1))
+			;
+		*s = old[i];
+		st->live++;
+	}
+	free(old);
+}
+
+/*
+ * Same capacity: clear the tombstones and reinsert every entry in
+ * place. The scan starts past a slot that was empty, which no probe run
+ * crosses, so each entry's run begins at or before it and entries only
+ * move back, into slots the scan has already settled.
+ */
+static void
+sweep(Ui9States *st)
+{
+	Ui9State e, *s;
+	ulong i, h, m, z;
+	int k;
+
+	m = st->cap-1;
+	for(z=0; st->tab[z].id != 0; z++)
+		;
+	for(i=0; i<st->cap; i++)
+		if(st->tab[i].id == Dead)
+			st->tab[i].id = 0;
+	for(k=1; k<st->cap; k++){
+		i = (z+k) & m;
+		if(st->tab[i].id == 0)
+			continue;
+		e = st->tab[i];
+		st->tab[i].id = 0;
+		for(h = slot(st, e.id); (s = &st->tab[h])->id != 0; h = (h+1) & m)
+			;
+		*s = e;
+	}
+	st->dead = 0;
+}
+
+static Ui9States*
+states(Ui9 *ui)
+{
+	Ui9States *st;
+
+	if(ui->states != nil)
+		return ui->states;
+	st = mallocz(sizeof *st, 1);
+	if(st == nil)
+		sysfatal("ui9state: malloc: %r");
+	rehash(st, MinStates);
+	ui->states = st;
+	return st;
+}
+
+/*
+ * State for id, created zeroed (down = -1: button state not seen yet)
+ * on first use. The pointer is valid until the next ui9_state call.
+ */
+Ui9State*
+ui9_state(Ui9 *ui, ulong id)
+{
+	Ui9States *st;
+	Ui9State *s, *tomb;
+	ulong h;
+
+	if(ui == nil || id == 0 || id == Dead)
+		return nil;
+	st = states(ui);
+	tomb = nil;
+	for(h = slot(st, id); (s = &st->tab[h])->id != 0; h = (h+1) & (st->cap-1)){
+		if(s->id == id){
+			s->frame = st->frame;
+			return s;
+		}
+		if(s->id == Dead && tomb == nil)
+			tomb = s;
+	}
+
+	if((st->live + st->dead + 1) * 2 > st->cap){
+		if((st->live + 1) * 4 > st->cap)
+			rehash(st, st->cap*2);
+		else
+			sweep(st);
+		return ui9_state(ui, id);
+	}
+	if(tomb != nil){
+		s = tomb;
+		st->dead--;
+	}
+	memset(s, 0, sizeof *s);
+	s->id = id;
+	s->down = -1;
+	s->frame = st->frame;
+	st->live++;
+	return s;
+}
+
+/* called by ui9_begin: drop entries untouched during the last frame */
+void
+ui9_statebegin(Ui9 *ui)
+{
+	Ui9States *st;
+	int i;
+
+	if(ui == nil || ui->states == nil)
+		return;
+	st = ui->states;
+	for(i=0; i<st->cap; i++)
+		if(st->tab[i].id != 0 && st->tab[i].id != Dead && st->tab[i].frame != st->frame){
+			st->tab[i].id = Dead;
+			st->live--;
+			st->dead++;
+		}
+	st->frame++;
+	st->animating = 0;
+}
+
+/*
+ * Hot/active bookkeeping for a clickable rect, from the ui9_input
+ * snapshot. Returns 1 on the frame the button is released over r after
+ * being pressed over it. The widget holds the capture while pressed.
+ */
+int
+ui9_clickable(Ui9 *ui, ulong id, Rectangle r, Ui9State **sp)
+{
+	Ui9State *s;
+	int down, clicked;
+
+	if(sp != nil)
+		*sp = nil;
+	s = ui9_state(ui, id);
+	if(s == nil)
+		return 0;
+	if(sp != nil)
+		*sp = s;
+
+	down = ui->m.buttons & 1;
+	if(s->down < 0)
+		s->down = down;   /* appeared under a held button: not a press */
+	s->r = r;
+	s->hot = ptinrect(ui->m.xy, r) && (ui->captureid == 0 || ui->captureid == id);
+
+	clicked = 0;
+	if(down && !s->down && s->hot){
+		s->active = 1;
+		ui9_setcapture(ui, id);
+	}else if(!down && s->active){
+		clicked = s->hot;
+		s->active = 0;
+		if(ui9_iscapture(ui, id))
+			ui9_releasecapture(ui);
+	}
+	s->down = down;
+	return clicked;
+}
+
+/* step s->t toward target; flags the frame as animating until it lands */
+int
+ui9_animate(Ui9 *ui, Ui9State *s, int target)
+{
+	if(s == nil)
+		return target;
+	if(s->t < target)
+		s->t = s->t + AnimStep < target ? s->t + AnimStep : target;
+	else if(s->t > target)
+		s->t = s->t - AnimStep > target ? s->t - AnimStep : target;
+	if(s->t != target && ui->states != nil)
+		ui->states->animating = 1;
+	return s->t;
+}
+
+int
+ui9_animating(Ui9 *ui)
+{
+	return ui != nil && ui->states != nil && ui->states->animating;
+}
+
+void
+ui9_statefree(Ui9 *ui)
+{
+	if(ui == nil || ui->states == nil)
+		return;
+	free(ui->states->tab);
+	free(ui->states);
+	ui->states = nil;
+}
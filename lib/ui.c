@@ -69,35 +69,51 @@ mk1x1(Display *d, int chan, ulong col)
 	return allocimage(d, Rect(0,0,1,1), chan, 1, col);
 }
 
+/*
+ * Allocate one token and record its class.  col is the final
+ * colour value; a is the alpha it was built with.
+ */
+static Image*
+mktoken(Ui9 *ui, int role, ulong col, int a)
+{
+	if(a >= 255){
+		ui->cls[role] = Ui9Opaque;
+		return mk1x1(ui->d, RGB24, col);
+	}
+	ui->cls[role] = (a <= 0) ? Ui9Invisible : Ui9Translucent;
+	return mk1x1(ui->d, RGBA32, col);
+}
+
 /* Build theme tokens as 1x1 images. */
 static void
 ui9rebuild(Ui9 *ui)
 {
 	Ui9Theme *t = &ui->theme;
-	int i;
+	int i, a;
 
 	for(i=0; i<Ui9CCount; i++)
 		freeimg(&ui->img[i]);
 
 	/* Base tokens */
-	ui->img[Ui9CBg]       = mk1x1(ui->d, RGB24, t->bgrgb);
-	ui->img[Ui9CSurface]  = mk1x1(ui->d, RGBA32,
-		(t->style == Ui9StyleGlass) ? setalpha(t->surfacergb, (uchar)t->alpha) : setalpha(t->surfacergb, 255));
-	ui->img[Ui9CSurface2] = mk1x1(ui->d, RGBA32,
-		(t->style == Ui9StyleGlass) ? setalpha(t->surface2rgb, (uchar)clampi(t->alpha + 25, 0, 255)) : setalpha(t->surface2rgb, 255));
+	ui->img[Ui9CBg] = mktoken(ui, Ui9CBg, t->bgrgb, 255);
 
-	ui->img[Ui9CText]   = mk1x1(ui->d, RGB24, t->textrgb);
-	ui->img[Ui9CMuted]  = mk1x1(ui->d, RGB24, t->mutedrgb);
+	a = (t->style == Ui9StyleGlass) ? t->alpha : 255;
+	ui->img[Ui9CSurface] = mktoken(ui, Ui9CSurface, setalpha(t->surfacergb, (uchar)a), a);
+	a = (t->style == Ui9StyleGlass) ? clampi(t->alpha + 25, 0, 255) : 255;
+	ui->img[Ui9CSurface2] = mktoken(ui, Ui9CSurface2, setalpha(t->surface2rgb, (uchar)a), a);
 
-	/* Border + shadow are RGBA32 to allow style-controlled transparency */
-	ui->img[Ui9CBorder] = mk1x1(ui->d, RGBA32, setalpha(t->borderrgb, (uchar)t->bordera));
-	ui->img[Ui9CShadow] = mk1x1(ui->d, RGBA32, setalpha(DBlack, (uchar)t->shadowa));
+	ui->img[Ui9CText]  = mktoken(ui, Ui9CText, t->textrgb, 255);
+	ui->img[Ui9CMuted] = mktoken(ui, Ui9CMuted, t->mutedrgb, 255);
 
-	ui->img[Ui9CAccent]  = mk1x1(ui->d, RGBA32, setalpha(t->accentrgb, 255));
-	ui->img[Ui9CAccent2] = mk1x1(ui->d, RGBA32, setalpha(t->accentrgb, 40));
+	/* Border + shadow carry style-controlled transparency */
+	ui->img[Ui9CBorder] = mktoken(ui, Ui9CBorder, setalpha(t->borderrgb, (uchar)t->bordera), t->bordera);
+	ui->img[Ui9CShadow] = mktoken(ui, Ui9CShadow, setalpha(DBlack, (uchar)t->shadowa), t->shadowa);
 
-	ui->img[Ui9CTopbarBg]   = mk1x1(ui->d, RGB24, t->topbgrgb);
-	ui->img[Ui9CTopbarText] = mk1x1(ui->d, RGB24, t->toptextrgb);
+	ui->img[Ui9CAccent]  = mktoken(ui, Ui9CAccent, setalpha(t->accentrgb, 255), 255);
+	ui->img[Ui9CAccent2] = mktoken(ui, Ui9CAccent2, setalpha(t->accentrgb, 40), 40);
+
+	ui->img[Ui9CTopbarBg]   = mktoken(ui, Ui9CTopbarBg, t->topbgrgb, 255);
+	ui->img[Ui9CTopbarText] = mktoken(ui, Ui9CTopbarText, t->toptextrgb, 255);
 
 	for(i=0; i<Ui9CCount; i++)
 		if(ui->img[i] == nil)
@@ -120,6 +136,10 @@ void
 ui9free(Ui9 *ui)
 {
 	int i;
+
+	ui9icon_free(ui);
+	ui9_hitfree(ui);
+	ui9_statefree(ui);
 	for(i=0; i<Ui9CCount; i++)
 		freeimg(&ui->img[i]);
 }
@@ -240,3 +260,17 @@ ui9img(Ui9 *ui, int role)
 		return nil;
 	return ui->img[role];
 }
+
+int
+ui9class(Ui9 *ui, int role)
+{
+	if(role < 0 || role >= Ui9CCount)
+		return Ui9Invisible;
+	return ui->cls[role];
+}
+
+int
+ui9visible(Ui9 *ui, int role)
+{
+	return ui9class(ui, role) != Ui9Invisible;
+}
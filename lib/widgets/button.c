@@ -32,3 +32,19 @@ ui9_button_draw(Ui9 *ui, Rectangle r, char *label, int kind, int state)
 
 	string(ui->dst, p, txt, ZP, f, label);
 }
+
+/*
+ * Interactive button: draws pressed while held over r and returns 1
+ * on the frame the click completes. Needs ui9_input + ui9_begin.
+ */
+int
+ui9_button(Ui9 *ui, ulong id, Rectangle r, char *label, int kind)
+{
+	Ui9State *s;
+	int clicked;
+
+	clicked = ui9_clickable(ui, id, r, &s);
+	ui9_button_draw(ui, r, label, kind,
+		(s != nil && s->active && s->hot) ? Ui9StatePressed : Ui9StateNormal);
+	return clicked;
+}
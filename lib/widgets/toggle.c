@@ -11,8 +11,9 @@
  * This intentionally does NOT draw a “card” background.
  */
 
-void
-ui9_toggle_draw(Ui9 *ui, Rectangle r, char *label, int on)
+/* t: knob position, 0 = off .. 255 = on */
+static void
+drawtoggle(Ui9 *ui, Rectangle r, char *label, int t)
 {
 	Font *f = ui->font ? ui->font : font;
 	int sw = 46, sh = 22;
@@ -30,19 +31,40 @@ ui9_toggle_draw(Ui9 *ui, Rectangle r, char *label, int on)
 	/* Track on the right */
 	track = Rect(r.max.x - sw, r.min.y + (Dy(r)-sh)/2, r.max.x, r.min.y + (Dy(r)+sh)/2);
 
-	tfill = on ? ui9img(ui, Ui9CAccent) : ui9img(ui, Ui9CSurface2);
+	tfill = t >= 128 ? ui9img(ui, Ui9CAccent) : ui9img(ui, Ui9CSurface2);
 	ui9_roundrect(ui, track, rad, tfill);
 	border(ui->dst, track, 1, ui9img(ui, Ui9CBorder), ZP);
 
-	/* Square knob */
+	/* Square knob, slid between the ends by t */
 	knob = insetrect(track, 3);
-	if(on){
-		knob.min.x = knob.max.x - (sh-6);
-		knob.max.x = track.max.x - 3;
-	}else{
-		knob.max.x = knob.min.x + (sh-6);
-		knob.min.x = track.min.x + 3;
-	}
+	knob.min.x = track.min.x + 3 + (sw - sh) * t / 255;
+	knob.max.x = knob.min.x + (sh-6);
 	ui9_roundrect(ui, knob, rad, ui9img(ui, Ui9CSurface));
 	border(ui->dst, knob, 1, ui9img(ui, Ui9CBorder), ZP);
 }
+
+void
+ui9_toggle_draw(Ui9 *ui, Rectangle r, char *label, int on)
+{
+	drawtoggle(ui, r, label, on ? 255 : 0);
+}
+
+/*
+ * Interactive toggle: flips *on when clicked and returns 1 then. The
+ * knob slides over a few frames; keep drawing while ui9_animating.
+ */
+int
+ui9_toggle(Ui9 *ui, ulong id, Rectangle r, char *label, int *on)
+{
+	Ui9State *s;
+	int changed;
+
+	s = ui9_state(ui, id);
+	if(s != nil && s->down < 0)
+		s->t = *on ? 255 : 0;   /* first frame: no slide in */
+	changed = ui9_clickable(ui, id, r, &s);
+	if(changed)
+		*on = !*on;
+	drawtoggle(ui, r, label, ui9_animate(ui, s, *on ? 255 : 0));
+	return changed;
+}
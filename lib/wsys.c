@@ -0,0 +1,266 @@
+#include <u.h>
+#include <libc.h>
+#include <draw.h>
+#include "../include/9deui/9deui.h"
+
+/*
+ * Incremental rio window model (see wsys.h). One update costs a
+ * directory read on the held fd, an open+read of each wctl, and one
+ * pread per label (none when the server versions labels and the
+ * version has not moved).
+ */
+
+static void*
+grow(void *p, int *cap, int n, int sz)
+{
+	if(n < *cap)
+		return p;
+	*cap = *cap ? *cap*2 : 16;
+	p = realloc(p, *cap * sz);
+	if(p == nil)
+		sysfatal("ui9wsys: %r");
+	return p;
+}
+
+static void
+delta(Ui9Wsys *w, int op, int id)
+{
+	w->d = grow(w->d, &w->ad, w->nd, sizeof w->d[0]);
+	w->d[w->nd].op = op;
+	w->d[w->nd].id = id;
+	w->nd++;
+}
+
+/* index of id, or where it would go */
+static int
+slot(Ui9Wsys *w, int id)
+{
+	int lo, hi, m;
+
+	lo = 0;
+	hi = w->nwin;
+	while(lo < hi){
+		m = (lo+hi)/2;
+		if(w->win[m].id < id)
+			lo = m+1;
+		else
+			hi = m;
+	}
+	return lo;
+}
+
+Ui9Win*
+ui9wsys_find(Ui9Wsys *w, int id)
+{
+	int i;
+
+	i = slot(w, id);
+	if(i < w->nwin && w->win[i].id == id)
+		return &w->win[i];
+	return nil;
+}
+
+static Ui9Win*
+insert(Ui9Wsys *w, int id)
+{
+	Ui9Win *x;
+	int i;
+
+	w->win = grow(w->win, &w->awin, w->nwin, sizeof w->win[0]);
+	i = slot(w, id);
+	memmove(&w->win[i+1], &w->win[i], (w->nwin-i) * sizeof w->win[0]);
+	w->nwin++;
+	x = &w->win[i];
+	memset(x, 0, sizeof *x);
+	x->id = id;
+	x->labelfd = -1;
+	return x;
+}
+
+static void
+delete(Ui9Wsys *w, Ui9Win *x)
+{
+	int i;
+
+	if(x->labelfd >= 0)
+		close(x->labelfd);
+	i = x - w->win;
+	memmove(&w->win[i], &w->win[i+1], (w->nwin-i-1) * sizeof w->win[0]);
+	w->nwin--;
+}
+
+/* wctl: "minx miny maxx maxy visible|hidden current|notcurrent" */
+static int
+readcurrent(Ui9Wsys *w, int id, int *cur)
+{
+	char path[256], buf[128], *f[8];
+	int fd, n;
+
+	snprint(path, sizeof path, "%s/%d/wctl", w->root, id);
+	fd = open(path, OREAD);
+	w->opens++;
+	if(fd < 0)
+		return -1;
+	n = read(fd, buf, sizeof buf-1);
+	close(fd);
+	w->reads++;
+	if(n <= 0)
+		return -1;
+	buf[n] = 0;
+	if(getfields(buf, f, nelem(f), 1, " \t\r\n") < 6)
+		return -1;
+	*cur = strcmp(f[5], "current") == 0;
+	return 0;
+}
+
+/* 1 if the label changed */
+static int
+readlabel(Ui9Wsys *w, Ui9Win *x, int fresh)
+{
+	char path[256], buf[Ui9WinLabel];
+	Dir *d;
+	int n;
+
+	if(x->labelfd < 0){
+		snprint(path, sizeof path, "%s/%d/label", w->root, x->id);
+		x->labelfd = open(path, OREAD);
+		w->opens++;
+		if(x->labelfd < 0){
+			if(x->label[0] != 0)
+				return 0;
+			strecpy(x->label, x->label+sizeof x->label, "window");
+			return 1;
+		}
+		fresh = 1;
+	}
+	if(w->versioned || fresh){
+		d = dirfstat(x->labelfd);
+		if(d != nil){
+			if(d->qid.vers != 0)
+				w->versioned = 1;
+			if(w->versioned && !fresh && d->qid.vers == x->labelvers){
+				free(d);
+				w->skipped++;
+				return 0;
+			}
+			x->labelvers = d->qid.vers;
+			free(d);
+		}
+	}
+	n = pread(x->labelfd, buf, sizeof buf-1, 0);
+	w->reads++;
+	if(n < 0){
+		close(x->labelfd);
+		x->labelfd = -1;
+		return 0;
+	}
+	buf[n] = 0;
+	while(n > 0 && (buf[n-1] == '\n' || buf[n-1] == '\r'))
+		buf[--n] = 0;
+	if(n == 0)
+		strecpy(buf, buf+sizeof buf, "window");
+	if(strcmp(x->label, buf) == 0)
+		return 0;
+	strecpy(x->label, x->label+sizeof x->label, buf);
+	return 1;
+}
+
+Ui9Wsys*
+ui9wsys_open(char *root)
+{
+	Ui9Wsys *w;
+
+	w = mallocz(sizeof *w, 1);
+	if(w == nil)
+		sysfatal("ui9wsys: %r");
+	w->root = strdup(root != nil ? root : "/dev/wsys");
+	if(w->root == nil)
+		sysfatal("ui9wsys: %r");
+	w->dirfd = -1;
+	w->focus = -1;
+	return w;
+}
+
+int
+ui9wsys_update(Ui9Wsys *w)
+{
+	Dir *d;
+	Ui9Win *x;
+	int i, n, id, cur, fresh, focus;
+
+	w->nd = 0;
+	w->polls++;
+	if(w->dirfd < 0){
+		w->dirfd = open(w->root, OREAD);
+		w->opens++;
+		if(w->dirfd < 0)
+			return -1;
+	}else if(seek(w->dirfd, 0, 0) < 0){
+		close(w->dirfd);
+		w->dirfd = -1;
+		return -1;
+	}
+	n = dirreadall(w->dirfd, &d);
+	w->reads++;
+	if(n < 0){
+		close(w->dirfd);
+		w->dirfd = -1;
+		return -1;
+	}
+
+	w->gen++;
+	focus = -1;
+	for(i=0; i<n; i++){
+		if(!(d[i].qid.type & QTDIR) || (id = atoi(d[i].name)) <= 0)
+			continue;
+		x = ui9wsys_find(w, id);
+		fresh = x == nil;
+		if(readcurrent(w, id, &cur) < 0){
+			/* closing under us; a known window is kept until it leaves the listing */
+			if(!fresh)
+				x->seen = w->gen;
+			continue;
+		}
+		if(fresh)
+			x = insert(w, id);
+		x->seen = w->gen;
+		x->current = cur;
+		if(readlabel(w, x, fresh) && !fresh)
+			delta(w, Ui9WinTitle, id);
+		if(fresh)
+			delta(w, Ui9WinAdd, id);
+		if(cur)
+			focus = id;
+	}
+	free(d);
+
+	for(i=w->nwin-1; i>=0; i--)
+		if(w->win[i].seen != w->gen){
+			delta(w, Ui9WinDel, w->win[i].id);
+			delete(w, &w->win[i]);
+		}
+
+	if(focus != w->focus){
+		w->focus = focus;
+		delta(w, Ui9WinFocus, focus);    /* -1: nothing is current now */
+	}
+	return w->nd;
+}
+
+void
+ui9wsys_close(Ui9Wsys *w)
+{
+	int i;
+
+	if(w == nil)
+		return;
+	for(i=0; i<w->nwin; i++)
+		if(w->win[i].labelfd >= 0)
+			close(w->win[i].labelfd);
+	if(w->dirfd >= 0)
+		close(w->dirfd);
+	free(w->win);
+	free(w->d);
+	free(w->root);
+	free(w);
+}